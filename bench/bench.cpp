@@ -0,0 +1,97 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace Bench {
+    struct Benchmark {
+        std::string name;
+        const char *unit;
+        Function function;
+    };
+
+    // Registrations run during static initialization, in whatever order the linker picks, so the list is created
+    // on first use
+    static std::vector<Benchmark> &registry() {
+        static std::vector<Benchmark> benchmarks;
+        return benchmarks;
+    }
+
+    Registration::Registration(const char *name, const char *unit, Function function) {
+        registry().push_back(Benchmark{ name, unit, function });
+    }
+
+    struct Measurement {
+        long iterations;
+        double seconds;
+        long items;
+    };
+
+    static Measurement measure(const Benchmark &benchmark, long iterations) {
+        State state(iterations);
+        const auto start = std::chrono::steady_clock::now();
+        benchmark.function(state);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return Measurement{ iterations, seconds, state.itemsProcessed() };
+    }
+
+    /**
+     * @brief runAll - time each benchmark and print its median time per iteration, and its rate if it counts items
+     * @param filter - only run benchmarks whose name contains this
+     * @param minSeconds - the shortest a single measurement may take
+     * @param repetitions - the number of measurements per benchmark
+     */
+    void runAll(const std::string &filter, double minSeconds, int repetitions) {
+        std::vector<Benchmark> benchmarks = registry();
+        std::sort(benchmarks.begin(), benchmarks.end(), [](const Benchmark &a, const Benchmark &b) { return a.name < b.name; });
+
+        std::printf("%-36s %12s %14s %20s\n", "benchmark", "iterations", "ns/op", "rate");
+
+        for (const Benchmark &benchmark : benchmarks) {
+            if (benchmark.name.find(filter) == std::string::npos) {
+                continue;
+            }
+
+            // grow the loop until one run of it is long enough to time
+            long iterations = 1;
+            Measurement calibration = measure(benchmark, iterations);
+            while (calibration.seconds < minSeconds && iterations < (1L << 40)) {
+                const double scale = calibration.seconds > 0 ? 1.4 * minSeconds / calibration.seconds : 10;
+                iterations = std::max(iterations + 1, long(iterations * std::min(scale, 10.0)));
+                calibration = measure(benchmark, iterations);
+            }
+
+            std::vector<Measurement> measurements = { calibration };
+            for (int i = 1; i < repetitions; i++) {
+                measurements.push_back(measure(benchmark, iterations));
+            }
+
+            std::sort(measurements.begin(), measurements.end(), [](const Measurement &a, const Measurement &b) {
+                return a.seconds < b.seconds;
+            });
+            const Measurement &median = measurements[measurements.size() / 2];
+
+            char rate[64] = "";
+            if (benchmark.unit != nullptr && median.items > 0) {
+                double perSecond = median.items / median.seconds;
+                const char *prefix = "";
+                if (perSecond >= 1e9) {
+                    perSecond /= 1e9;
+                    prefix = "G";
+                } else if (perSecond >= 1e6) {
+                    perSecond /= 1e6;
+                    prefix = "M";
+                } else if (perSecond >= 1e3) {
+                    perSecond /= 1e3;
+                    prefix = "k";
+                }
+                std::snprintf(rate, sizeof(rate), "%.2f %s%s/s", perSecond, prefix, benchmark.unit);
+            }
+
+            std::printf("%-36s %12ld %14.1f %20s\n", benchmark.name.c_str(), median.iterations,
+                        1e9 * median.seconds / median.iterations, rate);
+            std::fflush(stdout);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// A small benchmark harness, so the benchmarks build anywhere the renderer does with nothing to download. Each
+// benchmark runs its kernel in a loop; the harness grows the loop until it runs long enough to time reliably, repeats
+// the measurement, and reports the median time per iteration.
+namespace Bench {
+    class State {
+    public:
+        explicit State(long iterations) : m_iterations(iterations) {}
+
+        // The number of times the benchmark should run its kernel
+        long iterations() const { return m_iterations; }
+
+        // How many items (rays, pixels, texels) the kernel processed in total, to report a rate as well as a time
+        void setItemsProcessed(long items) { m_items = items; }
+        long itemsProcessed() const { return m_items; }
+
+    private:
+        long m_iterations;
+        long m_items = 0;
+    };
+
+    using Function = std::function<void(State &state)>;
+
+    // Adds a benchmark to the suite; used through BENCHMARK below
+    struct Registration {
+        Registration(const char *name, const char *unit, Function function);
+    };
+
+    // Keeps the compiler from optimizing away a result the benchmark otherwise ignores
+    template <typename T>
+    inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static const volatile void *sink;
+        sink = &value;
+#endif
+    }
+
+    // Runs every benchmark whose name contains filter, printing a line for each
+    // @param minSeconds How long each measurement has to run for.
+    // @param repetitions How many measurements to take the median of.
+    void runAll(const std::string &filter, double minSeconds, int repetitions);
+}
+
+// Defines a benchmark. unit names what State::setItemsProcessed counts, e.g. "rays", or is null for none.
+#define BENCHMARK(name, unit) \
+    static void name(Bench::State &state); \
+    static Bench::Registration name##Registration(#name, unit, name); \
+    static void name(Bench::State &state)
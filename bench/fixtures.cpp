@@ -0,0 +1,104 @@
+#include "fixtures.h"
+
+#include <glm/gtx/transform.hpp>
+
+namespace Fixtures {
+    static RenderShapeData shape(PrimitiveType type, const glm::mat4 &ctm, const glm::vec4 &diffuse, const glm::vec4 &reflective) {
+        RenderShapeData data{};
+        data.primitive.type = type;
+        data.primitive.material.clear();
+        data.primitive.material.cAmbient = 0.2f * diffuse;
+        data.primitive.material.cDiffuse = diffuse;
+        data.primitive.material.cSpecular = glm::vec4(0.5f);
+        data.primitive.material.shininess = 20.f;
+        data.primitive.material.cReflective = reflective;
+        data.ctm = ctm;
+        return data;
+    }
+
+    RenderData scene() {
+        RenderData data{};
+        data.globalData.ka = 0.5f;
+        data.globalData.kd = 0.5f;
+        data.globalData.ks = 0.5f;
+        data.globalData.numFrames = 1;
+        data.globalData.framerate = 24;
+
+        data.cameraData.pos = glm::vec4(0.f, 1.f, 6.f, 1.f);
+        data.cameraData.look = glm::vec4(0.f, -0.15f, -1.f, 0.f);
+        data.cameraData.up = glm::vec4(0.f, 1.f, 0.f, 0.f);
+        data.cameraData.heightAngle = 0.8f;
+
+        SceneLightData point{};
+        point.type = LightType::LIGHT_POINT;
+        point.color = glm::vec4(1.f);
+        point.function = glm::vec3(1.f, 0.f, 0.f);
+        point.pos = glm::vec4(3.f, 4.f, 3.f, 1.f);
+        data.lights.push_back(point);
+
+        SceneLightData directional{};
+        directional.type = LightType::LIGHT_DIRECTIONAL;
+        directional.color = glm::vec4(0.4f);
+        directional.dir = glm::vec4(-1.f, -2.f, -0.5f, 0.f);
+        data.lights.push_back(directional);
+
+        SceneLightData spot{};
+        spot.type = LightType::LIGHT_SPOT;
+        spot.color = glm::vec4(0.6f);
+        spot.function = glm::vec3(1.f, 0.f, 0.f);
+        spot.pos = glm::vec4(-3.f, 4.f, 2.f, 1.f);
+        spot.dir = glm::vec4(0.6f, -1.f, -0.4f, 0.f);
+        spot.angle = 0.6f;
+        spot.penumbra = 0.1f;
+        data.lights.push_back(spot);
+
+        data.shapes.push_back(shape(PrimitiveType::PRIMITIVE_CUBE, glm::translate(glm::vec3(0.f, -1.f, 0.f)) * glm::scale(glm::vec3(10.f, 0.2f, 10.f)),
+                                    glm::vec4(0.8f), glm::vec4(0.f)));
+        data.shapes.push_back(shape(PrimitiveType::PRIMITIVE_CUBE, glm::translate(glm::vec3(0.f, 0.f, 0.f)),
+                                    glm::vec4(1.f, 0.2f, 0.2f, 1.f), glm::vec4(0.f)));
+        data.shapes.push_back(shape(PrimitiveType::PRIMITIVE_SPHERE, glm::translate(glm::vec3(-2.f, 0.f, -2.f)),
+                                    glm::vec4(0.2f, 0.2f, 1.f, 1.f), glm::vec4(0.5f)));
+        data.shapes.push_back(shape(PrimitiveType::PRIMITIVE_CYLINDER, glm::translate(glm::vec3(2.5f, 0.f, -3.f)),
+                                    glm::vec4(0.2f, 1.f, 0.2f, 1.f), glm::vec4(0.f)));
+        data.shapes.push_back(shape(PrimitiveType::PRIMITIVE_CONE, glm::translate(glm::vec3(1.5f, 0.f, 1.f)),
+                                    glm::vec4(1.f, 1.f, 0.2f, 1.f), glm::vec4(0.f)));
+        return data;
+    }
+
+    std::vector<Ray> objectRays(int count) {
+        std::mt19937 random(SEED);
+        std::uniform_real_distribution<float> around(-2.f, 2.f);
+        std::uniform_real_distribution<float> inside(-0.4f, 0.4f);
+
+        std::vector<Ray> rays;
+        rays.reserve(count);
+        for (int i = 0; i < count; i++) {
+            glm::vec3 origin(around(random), around(random), around(random));
+            // start outside the unit cube, so every primitive is hit from the outside
+            origin += glm::sign(origin) * 0.6f;
+            glm::vec3 target(inside(random), inside(random), inside(random));
+            rays.push_back(Ray(origin, target - origin));
+        }
+        return rays;
+    }
+
+    std::vector<Ray> cameraRays(const RayTraceScene &scene) {
+        const Camera &camera = scene.getCamera();
+        const float V = 2 * tan(camera.getHeightAngle() / 2.0);
+        const float U = V * camera.getAspectRatio();
+
+        std::vector<Ray> rays;
+        rays.reserve(std::size_t(scene.width()) * scene.height());
+        for (int row = 0; row < scene.height(); row++) {
+            for (int col = 0; col < scene.width(); col++) {
+                float y = ((scene.height() - 1 - row + 0.5f) / scene.height()) - 0.5f;
+                float x = ((col + 0.5f) / scene.width()) - 0.5f;
+
+                Ray ray(glm::vec3(0.f), glm::normalize(glm::vec3(U * x, V * y, -1.f)));
+                ray.transform(camera.getInverseViewMatrix());
+                rays.push_back(ray);
+            }
+        }
+        return rays;
+    }
+}
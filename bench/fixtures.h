@@ -0,0 +1,22 @@
+#pragma once
+
+#include <random>
+#include <vector>
+#include "raytracer/ray.h"
+#include "raytracer/raytracescene.h"
+#include "utils/sceneparser.h"
+
+// Canned inputs for the benchmarks. Everything is generated from a fixed seed, so every run measures the same work.
+namespace Fixtures {
+    const unsigned SEED = 1230;
+
+    // A small scene with every primitive type, a floor, a mirror and three kinds of light
+    RenderData scene();
+
+    // Rays in object space from random points around the unit primitives towards random points inside them, so
+    // most of them hit
+    std::vector<Ray> objectRays(int count);
+
+    // The rays through the center of every pixel of a width x height image, as RayTracer generates them
+    std::vector<Ray> cameraRays(const RayTraceScene &scene);
+}
@@ -0,0 +1,189 @@
+#include "bench.h"
+#include "fixtures.h"
+
+#include <glm/gtx/transform.hpp>
+#include "filter/filter.h"
+#include "lighting/lightmodel.h"
+#include "primitives/objectprimitives.h"
+#include "primitives/solvers.h"
+#include "primitives/worldprimitive.h"
+#include "raytracer/raytracer.h"
+#include "texture/texture.h"
+
+// Micro-benchmarks for the kernels a render spends its time in. Kernels that work on a single ray or sample report
+// the time per call; the rest report the time per image, along with the number of items processed per second.
+
+namespace {
+    const int RAY_COUNT = 4096;
+    const int IMAGE_WIDTH = 96;
+    const int IMAGE_HEIGHT = 72;
+
+    // Runs a function on each canned ray in turn, once per iteration
+    template <typename F>
+    void perRay(Bench::State &state, const std::vector<Ray> &rays, F &&function) {
+        for (long i = 0; i < state.iterations(); i++) {
+            Bench::doNotOptimize(function(rays[i % rays.size()]));
+        }
+        state.setItemsProcessed(state.iterations());
+    }
+
+    const std::vector<Ray> &objectRays() {
+        static const std::vector<Ray> rays = Fixtures::objectRays(RAY_COUNT);
+        return rays;
+    }
+
+    // The scene data has to outlive the scene built from it, so both are kept for the whole run
+    const RayTraceScene &benchScene() {
+        static const RenderData data = Fixtures::scene();
+        static const RayTraceScene scene(IMAGE_WIDTH, IMAGE_HEIGHT, data);
+        return scene;
+    }
+
+    RayTracer::Config tracerConfig() {
+        RayTracer::Config config{};
+        config.enableShadow = true;
+        config.enableReflection = true;
+        return config;
+    }
+}
+
+// The quadratic solve on its own, with the coefficients of a sphere
+BENCHMARK(solver_quadratic, "rays") {
+    auto solver = Solvers::Quadratic(1.f, 0.5f, -0.25f, Constraints::None(), Normals::Sphere(), TextureMappers::Sphere());
+    perRay(state, objectRays(), solver);
+}
+
+BENCHMARK(solver_sphere, "rays") {
+    perRay(state, objectRays(), Solvers::Sphere());
+}
+
+BENCHMARK(solver_cylinder, "rays") {
+    perRay(state, objectRays(), Solvers::Cylinder());
+}
+
+BENCHMARK(solver_cone, "rays") {
+    perRay(state, objectRays(), Solvers::Cone());
+}
+
+BENCHMARK(object_cube, "rays") {
+    perRay(state, objectRays(), ObjectPrimitives::Cube());
+}
+
+BENCHMARK(object_sphere, "rays") {
+    perRay(state, objectRays(), ObjectPrimitives::Sphere());
+}
+
+BENCHMARK(object_cylinder, "rays") {
+    perRay(state, objectRays(), ObjectPrimitives::Cylinder());
+}
+
+BENCHMARK(object_cone, "rays") {
+    perRay(state, objectRays(), ObjectPrimitives::Cone());
+}
+
+// Includes moving the ray into object space and the normal back out of it
+BENCHMARK(world_primitive_sphere, "rays") {
+    SceneMaterial material{};
+    material.clear();
+    const glm::mat4 ctm = glm::translate(glm::vec3(0.3f, -0.2f, 0.1f)) * glm::rotate(0.5f, glm::vec3(0.f, 1.f, 0.f))
+            * glm::scale(glm::vec3(1.5f, 1.f, 1.f));
+    WorldPrimitive::Proxy primitive = WorldPrimitive::Primitive(ObjectPrimitives::Sphere(), ctm, material);
+    perRay(state, objectRays(), primitive);
+}
+
+// Shades random points on the floor of the canned scene
+static void benchPhong(Bench::State &state, bool shadows) {
+    const RayTraceScene &scene = benchScene();
+    const SceneMaterial &material = *scene.getMaterials()[0];
+
+    std::mt19937 random(Fixtures::SEED);
+    std::uniform_real_distribution<float> floor(-4.f, 4.f);
+    std::vector<glm::vec3> points(RAY_COUNT);
+    for (glm::vec3 &point : points) {
+        point = glm::vec3(floor(random), -0.9f, floor(random));
+    }
+
+    const glm::vec3 camera = glm::vec3(scene.getCamera().getInverseViewMatrix()[3]);
+    for (long i = 0; i < state.iterations(); i++) {
+        const glm::vec3 &point = points[i % points.size()];
+        Bench::doNotOptimize(phong(point, glm::vec3(0.f, 1.f, 0.f), glm::normalize(camera - point), material,
+                                   std::tuple<float, float>{ 0.f, 0.f }, scene.getTextures(), scene.getLights(),
+                                   scene.getGlobalData(), scene.getPrims(), shadows, false));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+BENCHMARK(phong_unshadowed, "samples") {
+    benchPhong(state, false);
+}
+
+BENCHMARK(phong_shadowed, "samples") {
+    benchPhong(state, true);
+}
+
+BENCHMARK(texture_get_pixel, "texels") {
+    const int size = 256;
+    Texture::Texture texture{ size, size, std::vector<RGBA>(size * size) };
+    std::mt19937 random(Fixtures::SEED);
+    for (RGBA &texel : texture.img) {
+        texel = RGBA{ std::uint8_t(random()), std::uint8_t(random()), std::uint8_t(random()), 255 };
+    }
+
+    SceneMaterial material{};
+    material.clear();
+    material.textureMap.isUsed = true;
+    material.textureMap.repeatU = 2.f;
+    material.textureMap.repeatV = 2.f;
+
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::vector<std::tuple<float, float>> uvs(RAY_COUNT);
+    for (auto &uv : uvs) {
+        uv = { unit(random), unit(random) };
+    }
+
+    for (long i = 0; i < state.iterations(); i++) {
+        Bench::doNotOptimize(Texture::getPixel(uvs[i % uvs.size()], texture, material));
+    }
+    state.setItemsProcessed(state.iterations());
+}
+
+// Blurs run on one thread, so the result doesn't depend on the machine's core count
+BENCHMARK(filter_blur_rgba, "pixels") {
+    std::vector<RGBA> image(IMAGE_WIDTH * IMAGE_HEIGHT, RGBA{ 128, 64, 32, 255 });
+    for (long i = 0; i < state.iterations(); i++) {
+        Filter::applyBlur(image.data(), IMAGE_WIDTH, IMAGE_HEIGHT, 3, false);
+        Bench::doNotOptimize(image[0]);
+    }
+    state.setItemsProcessed(state.iterations() * image.size());
+}
+
+BENCHMARK(filter_blur_float, "pixels") {
+    std::vector<glm::vec4> image(IMAGE_WIDTH * IMAGE_HEIGHT, glm::vec4(0.5f, 0.25f, 0.125f, 1.f));
+    for (long i = 0; i < state.iterations(); i++) {
+        Filter::applyBlur(image.data(), IMAGE_WIDTH, IMAGE_HEIGHT, 3, false);
+        Bench::doNotOptimize(image[0]);
+    }
+    state.setItemsProcessed(state.iterations() * image.size());
+}
+
+// Camera rays through the canned scene, with shadows and reflections
+BENCHMARK(trace_ray, "rays") {
+    const RayTraceScene &scene = benchScene();
+    const std::vector<Ray> rays = Fixtures::cameraRays(scene);
+    RayTracer raytracer{ tracerConfig() };
+
+    perRay(state, rays, [&](const Ray &ray) { return raytracer.traceRay(ray, scene); });
+}
+
+// A whole single-threaded frame of the canned scene, including ray generation
+BENCHMARK(render_frame, "pixels") {
+    const RayTraceScene &scene = benchScene();
+    RayTracer raytracer{ tracerConfig() };
+    FrameBuffer frame(IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    for (long i = 0; i < state.iterations(); i++) {
+        raytracer.render(frame, scene);
+        Bench::doNotOptimize(frame.pixels[0]);
+    }
+    state.setItemsProcessed(state.iterations() * frame.size());
+}
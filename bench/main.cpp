@@ -0,0 +1,33 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "bench.h"
+#include "fixtures.h"
+
+// Usage: skippy_bench [--filter <substring>] [--min-time <seconds>] [--repetitions <n>]
+int main(int argc, char *argv[]) {
+    std::string filter;
+    double minSeconds = 0.2;
+    int repetitions = 3;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--filter") {
+            filter = argv[++i];
+        } else if (i + 1 < argc && arg == "--min-time") {
+            minSeconds = std::atof(argv[++i]);
+        } else if (i + 1 < argc && arg == "--repetitions") {
+            repetitions = std::max(std::atoi(argv[++i]), 1);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--filter <substring>] [--min-time <seconds>] [--repetitions <n>]" << std::endl;
+            return 1;
+        }
+    }
+
+    // super-sampling jitter comes from rand(), so seed it too
+    std::srand(Fixtures::SEED);
+
+    Bench::runAll(filter, minSeconds, repetitions);
+    return 0;
+}
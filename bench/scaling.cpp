@@ -0,0 +1,288 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "core/skippy.h"
+#include "filter/tonemap.h"
+#include "output/framewriter.h"
+#include "raytracer/raytracescene.h"
+#include "raytracer/scenehash.h"
+
+// Thread-scaling benchmark: renders one frame of a scene with the thread pool capped at 1, 2, 4 ... threads and
+// reports how the render speeds up. Strong scaling keeps the frame the same, so ideally it takes 1/n of the time on n
+// threads; weak scaling takes n times as many samples per pixel on n threads, so ideally it takes the same time.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // 1, 2, 4 ... up to and always including maxThreads
+    std::vector<int> threadCounts(int maxThreads) {
+        std::vector<int> counts;
+        for (int threads = 1; threads < maxThreads; threads *= 2) {
+            counts.push_back(threads);
+        }
+        counts.push_back(maxThreads);
+        return counts;
+    }
+
+    // The time spent in each phase of rendering a frame, besides parsing, which only ever happens once
+    struct Phases {
+        double build = 0;
+        double trace = 0;
+        double filter = 0;
+        double encode = 0;
+
+        double total() const { return build + trace + filter + encode; }
+    };
+
+    /**
+     * @brief renderFrame - renders and encodes a frame the way the skippy executable does, timing each phase
+     */
+    Phases renderFrame(const RenderData &data, int width, int height, const RayTracer::Config &config, const QString &scratchPath) {
+        Phases phases;
+        RayTracer raytracer{ config };
+        FrameBuffer frame(width, height);
+        std::vector<RGBA> pixels(frame.size());
+
+        auto start = Clock::now();
+        RayTraceScene scene{ width, height, data };
+        phases.build = secondsSince(start);
+
+        start = Clock::now();
+        raytracer.renderRegion(frame, scene, DirtyRegion::Rect{ 0, 0, width, height });
+        phases.trace = secondsSince(start);
+
+        start = Clock::now();
+        raytracer.postProcess(frame, nullptr);
+        phases.filter = secondsSince(start);
+
+        start = Clock::now();
+        ToneMap::apply(frame, pixels.data(), ToneMap::Config{}, config.enableParallelism);
+        FrameWriter::writeBytes(scratchPath.toStdString(), "png", pixels.data(), width, height, -1);
+        phases.encode = secondsSince(start);
+        return phases;
+    }
+
+    // The fastest of a few renders of the same frame, which is the one least disturbed by anything else on the machine
+    Phases fastestFrame(const RenderData &data, int width, int height, const RayTracer::Config &config,
+                        const QString &scratchPath, int repetitions) {
+        Phases best;
+        for (int i = 0; i < repetitions; i++) {
+            Phases phases = renderFrame(data, width, height, config, scratchPath);
+            if (i == 0 || phases.total() < best.total()) {
+                best = phases;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief imbalance - traces a frame a row at a time across the pool, timing how long each worker spends busy.
+     * RayTracer hands out single pixels, which are too fine to time, so this measures the same work in rows.
+     * @return how much longer the busiest worker was busy than the average worker, as a fraction of the average
+     */
+    double imbalance(const RenderData &data, int width, int height, RayTracer::Config config) {
+        RayTraceScene scene{ width, height, data };
+        FrameBuffer frame(width, height);
+        config.enableParallelism = false;
+        RayTracer raytracer{ config };
+
+        std::mutex mutex;
+        std::map<std::thread::id, double> busy;
+
+        QVector<int> rows;
+        for (int row = 0; row < height; row++) {
+            rows.append(row);
+        }
+        QtConcurrent::blockingMap(rows, [&](int row) {
+            const auto start = Clock::now();
+            raytracer.renderRegion(frame, scene, DirtyRegion::Rect{ 0, row, width, row + 1 });
+            const double seconds = secondsSince(start);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            busy[std::this_thread::get_id()] += seconds;
+        });
+
+        // workers that never got a row still count towards the average, as they sat idle the whole time
+        const int workers = std::max(QThreadPool::globalInstance()->maxThreadCount(), int(busy.size()));
+        double total = 0, most = 0;
+        for (const auto &[thread, seconds] : busy) {
+            total += seconds;
+            most = std::max(most, seconds);
+        }
+        const double mean = total / workers;
+        return mean > 0 ? most / mean - 1 : 0;
+    }
+
+    /**
+     * @brief serialFraction - the Karp-Flatt metric: the fraction of the work that would have to be serial to explain
+     * a measured speedup under Amdahl's law
+     */
+    double serialFraction(double speedup, int threads) {
+        if (threads <= 1 || speedup <= 0) {
+            return 0;
+        }
+        return (1 / speedup - 1.0 / threads) / (1 - 1.0 / threads);
+    }
+
+    QJsonObject toJson(const Phases &phases) {
+        return QJsonObject{
+            { "build", phases.build }, { "trace", phases.trace }, { "filter", phases.filter },
+            { "encode", phases.encode }, { "total", phases.total() }
+        };
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("scene", "The scene file to render.");
+    QCommandLineOption widthOption("width", "Width to render at.", "pixels", "320");
+    QCommandLineOption heightOption("height", "Height to render at.", "pixels", "180");
+    QCommandLineOption samplesOption("samples", "Samples per pixel on one thread; weak scaling multiplies it by the thread count.", "n", "1");
+    QCommandLineOption frameOption("frame", "The frame of the animation to render.", "n", "0");
+    QCommandLineOption threadsOption("max-threads", "The most threads to try (default: every core).", "n");
+    QCommandLineOption repetitionsOption("repetitions", "Renders at each thread count, of which the fastest is kept.", "n", "3");
+    QCommandLineOption outputOption("output", "Where to write the JSON report.", "file", "scaling.json");
+    parser.addOptions({ widthOption, heightOption, samplesOption, frameOption, threadsOption, repetitionsOption, outputOption });
+    parser.process(a);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+    const QString path = parser.positionalArguments()[0];
+    const int width = parser.value(widthOption).toInt();
+    const int height = parser.value(heightOption).toInt();
+    const int samples = std::max(parser.value(samplesOption).toInt(), 1);
+    const int repetitions = std::max(parser.value(repetitionsOption).toInt(), 1);
+    const int maxThreads = parser.isSet(threadsOption) ? std::max(parser.value(threadsOption).toInt(), 1)
+                                                       : QThread::idealThreadCount();
+
+    auto parseStart = Clock::now();
+    std::shared_ptr<const Skippy::Scene> scene = Skippy::Scene::load(path.toStdString());
+    const double parseSeconds = secondsSince(parseStart);
+    if (!scene) {
+        std::cerr << "Error loading scene: \"" << path.toStdString() << "\"" << std::endl;
+        return 1;
+    }
+    const RenderData &data = scene->frame(std::clamp(parser.value(frameOption).toInt(), 0, scene->frameCount() - 1));
+
+    // every feature a scene might use is on, as in skippy_scenebench
+    RayTracer::Config config{};
+    config.enableShadow          = true;
+    config.enableReflection      = true;
+    config.enableRefraction      = true;
+    config.enableTextureMap      = true;
+    config.enableParallelism     = true;
+    config.enablePostProcess     = true;
+    config.enableAcceleration    = true;
+    config.deterministicSampling = true;
+
+    const QString scratchPath = QDir::tempPath() + "/skippy-scaling.png";
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int originalThreads = pool->maxThreadCount();
+
+    // load the textures and warm the caches before anything is timed
+    renderFrame(data, width, height, config, scratchPath);
+
+    std::printf("%s, %dx%d, %d sample(s) per pixel, parsed in %.3f s\n\n", path.toStdString().c_str(), width, height,
+                samples, parseSeconds);
+    std::printf("%7s | %9s %7s %10s %9s %9s %9s | %9s %10s\n", "threads", "strong s", "speedup", "efficiency",
+                "serial", "imbalance", "non-trace", "weak s", "efficiency");
+
+    QJsonArray results;
+    Phases strongBase, weakBase;
+    for (int threads : threadCounts(maxThreads)) {
+        pool->setMaxThreadCount(threads);
+
+        RayTracer::Config strongConfig = config;
+        strongConfig.enableSuperSample = samples > 1;
+        strongConfig.numSamples = samples;
+        const Phases strong = fastestFrame(data, width, height, strongConfig, scratchPath, repetitions);
+
+        RayTracer::Config weakConfig = config;
+        weakConfig.enableSuperSample = samples * threads > 1;
+        weakConfig.numSamples = samples * threads;
+        const Phases weak = fastestFrame(data, width, height, weakConfig, scratchPath, repetitions);
+
+        const double workerImbalance = imbalance(data, width, height, strongConfig);
+
+        if (threads == 1) {
+            strongBase = strong;
+            weakBase = weak;
+        }
+
+        // parsing happens once whatever the thread count, so it's part of the serial work of every run
+        const double strongSeconds = parseSeconds + strong.total();
+        const double speedup = (parseSeconds + strongBase.total()) / strongSeconds;
+        const double efficiency = speedup / threads;
+        const double serial = serialFraction(speedup, threads);
+        const double nonTrace = (strongSeconds - strong.trace) / strongSeconds;
+        const double weakSeconds = parseSeconds + weak.total();
+        const double weakEfficiency = (parseSeconds + weakBase.total()) / weakSeconds;
+
+        std::printf("%7d | %9.3f %6.2fx %9.1f%% %8.1f%% %8.1f%% %8.1f%% | %9.3f %9.1f%%\n", threads, strongSeconds,
+                    speedup, efficiency * 100, serial * 100, workerImbalance * 100, nonTrace * 100, weakSeconds,
+                    weakEfficiency * 100);
+        std::fflush(stdout);
+
+        results.append(QJsonObject{
+            { "threads", threads },
+            { "strong", QJsonObject{
+                { "seconds", strongSeconds }, { "phases", toJson(strong) }, { "speedup", speedup },
+                { "efficiency", efficiency }, { "serialFraction", serial }, { "imbalance", workerImbalance },
+                { "nonTraceFraction", nonTrace }
+            } },
+            { "weak", QJsonObject{
+                { "seconds", weakSeconds }, { "samples", weakConfig.numSamples }, { "phases", toJson(weak) },
+                { "efficiency", weakEfficiency }
+            } }
+        });
+    }
+    pool->setMaxThreadCount(originalThreads);
+    QFile::remove(scratchPath);
+
+    std::cout << std::endl
+              << "speedup and efficiency are against 1 thread; serial is the Karp-Flatt serial fraction; imbalance is how"
+              << std::endl << "much longer the busiest worker traced than the average; non-trace is the share of time spent"
+              << std::endl << "parsing, building, filtering and encoding." << std::endl;
+
+    QJsonObject report{
+        { "rendererVersion", SceneHash::RENDERER_VERSION },
+        { "scene", path },
+        { "width", width },
+        { "height", height },
+        { "samples", samples },
+        { "parseSeconds", parseSeconds },
+        { "results", results }
+    };
+
+    QFile output(parser.value(outputOption));
+    if (!output.open(QIODevice::WriteOnly) || output.write(QJsonDocument(report).toJson()) < 0) {
+        std::cerr << "Error: failed to write the report \"" << output.fileName().toStdString() << "\"" << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote \"" << output.fileName().toStdString() << "\"" << std::endl;
+    return 0;
+}
@@ -0,0 +1,285 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include "core/skippy.h"
+#include "farm/frameselection.h"
+#include "filter/tonemap.h"
+#include "output/framewriter.h"
+#include "raytracer/raytracescene.h"
+#include "raytracer/scenehash.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// End-to-end benchmark: renders a few frames of every scene file at a fixed size, recording how long each phase of
+// the render took, and optionally compares the results against an earlier run to catch regressions.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // The largest the process has been so far, in kilobytes, or 0 where that isn't available. It's a high-water mark
+    // for the whole run, so it can't be put down to any one scene.
+    long peakRssKb() {
+#if defined(__APPLE__)
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss / 1024;
+#elif defined(__unix__)
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+#else
+        return 0;
+#endif
+    }
+
+    struct Phases {
+        double parse = 0;
+        double build = 0;
+        double trace = 0;
+        double post = 0;
+        double encode = 0;
+    };
+
+    /**
+     * @brief benchScene - renders a few frames of a scene, timing each phase
+     * @return the scene's entry in the report, or an empty object if the scene couldn't be loaded
+     */
+    QJsonObject benchScene(const QString &path, int width, int height, int framesPerScene, const RayTracer::Config &config,
+                           const QString &scratchDir) {
+        const auto start = Clock::now();
+        Phases phases;
+
+        auto phaseStart = Clock::now();
+        std::shared_ptr<const Skippy::Scene> scene = Skippy::Scene::load(path.toStdString());
+        phases.parse = secondsSince(phaseStart);
+        if (!scene) {
+            return QJsonObject();
+        }
+
+        const std::vector<int> frames = FrameSelection::spread(scene->frameCount(), framesPerScene);
+        const int samples = config.enableSuperSample ? config.numSamples : 1;
+        RayTracer raytracer{ config };
+        FrameBuffer frameBuffer(width, height);
+        std::vector<RGBA> pixels(frameBuffer.size());
+        QJsonArray frameNumbers;
+
+        for (int frame : frames) {
+            frameNumbers.append(frame);
+
+            phaseStart = Clock::now();
+            RayTraceScene rtScene{ width, height, scene->frame(frame) };
+            phases.build += secondsSince(phaseStart);
+
+            phaseStart = Clock::now();
+            raytracer.renderRegion(frameBuffer, rtScene, DirtyRegion::Rect{ 0, 0, width, height });
+            phases.trace += secondsSince(phaseStart);
+
+            phaseStart = Clock::now();
+            raytracer.postProcess(frameBuffer, nullptr);
+            phases.post += secondsSince(phaseStart);
+
+            phaseStart = Clock::now();
+            ToneMap::apply(frameBuffer, pixels.data(), ToneMap::Config{}, config.enableParallelism);
+            FrameWriter::writeBytes((scratchDir + "/frame.png").toStdString(), "png", pixels.data(), width, height, -1);
+            phases.encode += secondsSince(phaseStart);
+        }
+
+        const double wallSeconds = secondsSince(start);
+        const double primaryRays = double(width) * height * samples * frames.size();
+
+        QJsonObject result;
+        result["scene"] = path;
+        result["frames"] = frameNumbers;
+        result["wallSeconds"] = wallSeconds;
+        result["phases"] = QJsonObject{
+            { "parse", phases.parse }, { "build", phases.build }, { "trace", phases.trace },
+            { "post", phases.post }, { "encode", phases.encode }
+        };
+        result["primaryRays"] = primaryRays;
+        result["raysPerSecond"] = phases.trace > 0 ? primaryRays / phases.trace : 0.0;
+        return result;
+    }
+
+    /**
+     * @brief compare - checks a report against a baseline, printing how each scene changed
+     * @param threshold - the fraction by which wall time, trace time or the run's peak memory may grow before it's a
+     * regression
+     * @return the number of regressions, or -1 if the two reports weren't made with the same settings
+     */
+    int compare(const QJsonObject &report, const QJsonObject &baseline, double threshold) {
+        for (const char *setting : { "width", "height", "samples", "framesPerScene", "parallel" }) {
+            if (report[setting] != baseline[setting]) {
+                std::cerr << "The baseline was recorded with a different " << setting << ", so it can't be compared" << std::endl;
+                return -1;
+            }
+        }
+
+        std::map<QString, QJsonObject> baselineScenes;
+        for (const QJsonValue &scene : baseline["scenes"].toArray()) {
+            baselineScenes[scene.toObject()["scene"].toString()] = scene.toObject();
+        }
+
+        int regressions = 0;
+        std::cout << std::endl << "Compared to the baseline (a regression is over " << int(threshold * 100) << "% worse):" << std::endl;
+
+        const double rssNow = report["peakRssKb"].toDouble();
+        const double rssThen = baseline["peakRssKb"].toDouble();
+        if (rssNow > 0 && rssThen > 0) {
+            const double change = rssNow / rssThen - 1;
+            const bool regressed = change > threshold;
+            regressions += regressed;
+            std::cout << "  peak RSS of the run: " << (change >= 0 ? "+" : "") << int(std::round(change * 100)) << "%"
+                      << (regressed ? " (REGRESSION)" : "") << std::endl;
+        }
+
+        for (const QJsonValue &value : report["scenes"].toArray()) {
+            const QJsonObject scene = value.toObject();
+            const QString name = scene["scene"].toString();
+            auto before = baselineScenes.find(name);
+            if (before == baselineScenes.end()) {
+                std::cout << "  " << name.toStdString() << ": not in the baseline" << std::endl;
+                continue;
+            }
+
+            struct Metric {
+                const char *label;
+                double now;
+                double then;
+            };
+            const Metric metrics[] = {
+                { "wall", scene["wallSeconds"].toDouble(), before->second["wallSeconds"].toDouble() },
+                { "trace", scene["phases"].toObject()["trace"].toDouble(), before->second["phases"].toObject()["trace"].toDouble() }
+            };
+
+            std::cout << "  " << name.toStdString() << ":";
+            for (const Metric &metric : metrics) {
+                if (metric.then <= 0) {
+                    continue;
+                }
+                const double change = metric.now / metric.then - 1;
+                const bool regressed = change > threshold;
+                regressions += regressed;
+                std::cout << " " << metric.label << " " << (change >= 0 ? "+" : "") << int(std::round(change * 100)) << "%"
+                          << (regressed ? " (REGRESSION)" : "");
+            }
+            std::cout << std::endl;
+        }
+
+        return regressions;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption scenesOption("scenes", "Directory of scene files to render.", "dir", "scenes");
+    QCommandLineOption widthOption("width", "Width to render at.", "pixels", "160");
+    QCommandLineOption heightOption("height", "Height to render at.", "pixels", "90");
+    QCommandLineOption samplesOption("samples", "Samples per pixel (1 turns super-sampling off).", "n", "1");
+    QCommandLineOption framesOption("frames", "Frames to render from each scene, spread over its animation.", "n", "3");
+    QCommandLineOption serialOption("serial", "Render on a single thread.");
+    QCommandLineOption outputOption("output", "Where to write the JSON report.", "file", "scenebench.json");
+    QCommandLineOption baselineOption("baseline", "A report from an earlier run to compare against.", "file");
+    QCommandLineOption thresholdOption("threshold", "How much worse than the baseline counts as a regression.", "fraction", "0.1");
+    parser.addOptions({ scenesOption, widthOption, heightOption, samplesOption, framesOption, serialOption, outputOption,
+                        baselineOption, thresholdOption });
+    parser.process(a);
+
+    const int width = parser.value(widthOption).toInt();
+    const int height = parser.value(heightOption).toInt();
+    const int samples = std::max(parser.value(samplesOption).toInt(), 1);
+    const int framesPerScene = std::max(parser.value(framesOption).toInt(), 1);
+
+    // every feature a scene might use is on, so each scene is measured doing everything it can
+    RayTracer::Config config{};
+    config.enableShadow       = true;
+    config.enableReflection   = true;
+    config.enableRefraction   = true;
+    config.enableTextureMap   = true;
+    config.enableParallelism  = !parser.isSet(serialOption);
+    config.enableSuperSample  = samples > 1;
+    config.numSamples         = samples;
+    config.enablePostProcess  = true;
+    config.enableAcceleration = true;
+
+    // super-sampling jitter comes from rand(), so every run takes the same samples
+    std::srand(1230);
+
+    const QString scratchDir = QDir::tempPath() + "/skippy-scenebench";
+    QDir().mkpath(scratchDir);
+
+    QDir scenesDir(parser.value(scenesOption));
+    QJsonArray scenes;
+    for (const QString &file : scenesDir.entryList({ "*.xml" }, QDir::Files, QDir::Name)) {
+        const QString path = scenesDir.filePath(file);
+        std::cout << "Benchmarking \"" << path.toStdString() << "\"" << std::endl;
+
+        QJsonObject result = benchScene(path, width, height, framesPerScene, config, scratchDir);
+        if (result.isEmpty()) {
+            std::cerr << "Error loading scene: \"" << path.toStdString() << "\"" << std::endl;
+            continue;
+        }
+
+        std::cout << "  " << result["wallSeconds"].toDouble() << " s, "
+                  << result["raysPerSecond"].toDouble() / 1e6 << " Mrays/s" << std::endl;
+        scenes.append(result);
+    }
+    QDir(scratchDir).removeRecursively();
+
+    QJsonObject report{
+        { "rendererVersion", SceneHash::RENDERER_VERSION },
+        { "width", width },
+        { "height", height },
+        { "samples", samples },
+        { "framesPerScene", framesPerScene },
+        { "parallel", config.enableParallelism },
+        { "peakRssKb", double(peakRssKb()) },
+        { "scenes", scenes }
+    };
+
+    QFile output(parser.value(outputOption));
+    if (!output.open(QIODevice::WriteOnly) || output.write(QJsonDocument(report).toJson()) < 0) {
+        std::cerr << "Error: failed to write the report \"" << output.fileName().toStdString() << "\"" << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote \"" << output.fileName().toStdString() << "\"" << std::endl;
+
+    if (!parser.isSet(baselineOption)) {
+        return 0;
+    }
+
+    QFile baselineFile(parser.value(baselineOption));
+    if (!baselineFile.open(QIODevice::ReadOnly)) {
+        std::cerr << "Error: failed to read the baseline \"" << baselineFile.fileName().toStdString() << "\"" << std::endl;
+        return 1;
+    }
+
+    int regressions = compare(report, QJsonDocument::fromJson(baselineFile.readAll()).object(), parser.value(thresholdOption).toDouble());
+    if (regressions < 0) {
+        return 2;
+    }
+    if (regressions > 0) {
+        std::cerr << regressions << " regression(s) against the baseline" << std::endl;
+        return 1;
+    }
+    return 0;
+}
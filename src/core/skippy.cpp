@@ -0,0 +1,77 @@
+#include "skippy.h"
+
+#include <cstring>
+#include "raytracer/raytracescene.h"
+#include "utils/trace.h"
+
+namespace Skippy {
+    /**
+     * @brief Scene::load - parse a scene file and evaluate every frame of it
+     * @param path - the scene's xml file
+     * @return the scene, or null if it couldn't be loaded
+     */
+    std::shared_ptr<const Scene> Scene::load(const std::string &path) {
+        Trace::Span span("load scene", -1);
+        std::vector<RenderData*> parsed;
+        bool success = SceneParser::parse(path, parsed);
+
+        auto scene = std::make_shared<Scene>();
+        for (RenderData *data : parsed) {
+            scene->m_frames.emplace_back(data);
+        }
+
+        if (!success || scene->m_frames.empty()) {
+            return nullptr;
+        }
+        return scene;
+    }
+
+    int Scene::frameCount() const {
+        return int(m_frames.size());
+    }
+
+    int Scene::framerate() const {
+        return m_frames[0]->globalData.framerate;
+    }
+
+    const RenderData &Scene::frame(int index) const {
+        return *m_frames.at(index);
+    }
+
+    /**
+     * @brief render - trace a frame
+     * @param frame - the frame's scene data
+     * @param buffer - receives the image; its size is the size rendered at
+     * @param config - the tracer's settings
+     * @param aovs - if given, also receives the channels it has allocated
+     * @return whether the frame could be rendered, which it can't if any of its textures failed to load
+     */
+    bool render(const RenderData &frame, FrameBuffer &buffer, const RayTracer::Config &config, AOV::Buffers *aovs) {
+        RayTracer raytracer{ config };
+        RayTraceScene rtScene{ buffer.width, buffer.height, frame };
+        if (!rtScene.getFailedTextures().empty()) {
+            return false;
+        }
+
+        raytracer.render(buffer, rtScene, aovs);
+        return true;
+    }
+
+    /**
+     * @brief render - trace a frame into memory owned by the caller
+     * @param frame - the frame's scene data
+     * @param rgba - receives width * height * 4 floats
+     * @param width - the width of the image
+     * @param height - the height of the image
+     * @param config - the tracer's settings
+     * @return whether the frame could be rendered
+     */
+    bool render(const RenderData &frame, float *rgba, int width, int height, const RayTracer::Config &config) {
+        FrameBuffer buffer(width, height);
+        if (!render(frame, buffer, config)) {
+            return false;
+        }
+        std::memcpy(rgba, buffer.data(), sizeof(glm::vec4) * buffer.size());
+        return true;
+    }
+}
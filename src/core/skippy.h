@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "raytracer/raytracer.h"
+#include "utils/aov.h"
+#include "utils/framebuffer.h"
+#include "utils/sceneparser.h"
+
+// The renderer as a library: load a scene, evaluate its frames and render them into memory, with no config files,
+// image files or event loop involved. The skippy executable is a thin layer on top, and anything else (tools,
+// benchmarks, pipelines) can render many frames in one process and share its caches between them.
+namespace Skippy {
+    // A parsed scene with every frame of its animation evaluated. It never changes once loaded, so its frames can be
+    // rendered in any order and from any number of threads.
+    class Scene {
+    public:
+        // @return The scene, or null if the file can't be read or parsed.
+        static std::shared_ptr<const Scene> load(const std::string &path);
+
+        int frameCount() const;
+        int framerate() const;
+
+        // The shapes, lights and camera of a frame, with every keyframed value evaluated
+        const RenderData &frame(int index) const;
+
+    private:
+        std::vector<std::unique_ptr<RenderData>> m_frames;
+    };
+
+    // Renders a frame into a buffer, whose size sets the size of the image
+    // @return false if one of the frame's textures can't be loaded, in which case nothing is rendered.
+    bool render(const RenderData &frame, FrameBuffer &buffer, const RayTracer::Config &config, AOV::Buffers *aovs = nullptr);
+
+    // Renders a frame into plain memory: width * height linear RGBA floats, row by row from the top
+    // @return false if one of the frame's textures can't be loaded, in which case nothing is rendered.
+    bool render(const RenderData &frame, float *rgba, int width, int height, const RayTracer::Config &config);
+}
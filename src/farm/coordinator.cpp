@@ -0,0 +1,170 @@
+#include "coordinator.h"
+
+#include <algorithm>
+#include <iostream>
+
+Coordinator::Coordinator(const std::vector<std::vector<int>> &chunks, int maxAttempts, FinishedCallback onFinished) :
+    m_maxAttempts(maxAttempts),
+    m_onFinished(onFinished),
+    m_remaining(int(chunks.size()))
+{
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+        m_pending.push_back(Assignment{ FarmProtocol::Chunk{ int(i), chunks[i] }, 0 });
+    }
+
+    QObject::connect(&m_server, &QLocalServer::newConnection, [this]() { accept(); });
+}
+
+/**
+ * @brief Coordinator::listen - start accepting workers
+ * @param name - the name of the local socket (a path, or a name in the system's socket directory)
+ * @return whether the socket could be opened
+ */
+bool Coordinator::listen(const QString &name) {
+    QLocalServer::removeServer(name);
+    return m_server.listen(name);
+}
+
+int Coordinator::remaining() const {
+    return m_remaining;
+}
+
+/**
+ * @brief Coordinator::accept - take every waiting connection and start listening to it
+ */
+void Coordinator::accept() {
+    while (QLocalSocket *socket = m_server.nextPendingConnection()) {
+        m_connected.insert(socket);
+        QObject::connect(socket, &QLocalSocket::readyRead, [this, socket]() {
+            while (socket->canReadLine()) {
+                handleLine(socket, socket->readLine().trimmed());
+            }
+        });
+
+        // a worker that goes away takes its chunk with it, so hand that chunk to someone else
+        QObject::connect(socket, &QLocalSocket::disconnected, [this, socket]() {
+            m_connected.erase(socket);
+            m_waiting.erase(std::remove(m_waiting.begin(), m_waiting.end(), socket), m_waiting.end());
+
+            auto assigned = m_assigned.find(socket);
+            if (assigned != m_assigned.end()) {
+                std::cerr << "A worker disconnected partway through chunk " << assigned->second.chunk.id << std::endl;
+                Assignment assignment = assigned->second;
+                m_assigned.erase(assigned);
+                retry(assignment);
+            }
+            socket->deleteLater();
+        });
+    }
+}
+
+/**
+ * @brief Coordinator::handleLine - respond to a message from a worker
+ */
+void Coordinator::handleLine(QLocalSocket *socket, const QByteArray &line) {
+    QList<QByteArray> fields = line.split(' ');
+    const QByteArray &command = fields[0];
+
+    if (command == "READY") {
+        // every worker connected by the time the last chunk finished has already been told to stop
+        if (m_remaining == 0) {
+            return;
+        }
+
+        // a worker only asks again once it has reported its chunk, so one that doesn't has lost it
+        auto held = m_assigned.find(socket);
+        if (held != m_assigned.end()) {
+            std::cerr << "A worker asked for another chunk without reporting chunk " << held->second.chunk.id << std::endl;
+            Assignment assignment = held->second;
+            m_assigned.erase(held);
+            retry(assignment);
+        }
+
+        // giving up on that chunk may have been the last one, in which case the worker was just told to stop
+        if (m_remaining > 0) {
+            assign(socket);
+        }
+        return;
+    }
+
+    auto assigned = m_assigned.find(socket);
+    if ((command != "OK" && command != "FAIL") || assigned == m_assigned.end()
+            || fields.size() != 2 || fields[1].toInt() != assigned->second.chunk.id) {
+        std::cerr << "Ignoring unexpected message from a worker: \"" << line.toStdString() << "\"" << std::endl;
+        return;
+    }
+
+    Assignment assignment = assigned->second;
+    m_assigned.erase(assigned);
+
+    if (command == "OK") {
+        finishChunk();
+    } else {
+        std::cerr << "A worker failed chunk " << assignment.chunk.id << std::endl;
+        retry(assignment);
+    }
+}
+
+/**
+ * @brief Coordinator::assign - give a worker the next chunk. While other workers still have every chunk that's left,
+ * it waits instead, in case one of them fails and its chunk needs another worker.
+ */
+void Coordinator::assign(QLocalSocket *socket) {
+    if (m_pending.empty()) {
+        m_waiting.push_back(socket);
+        return;
+    }
+
+    Assignment assignment = m_pending.front();
+    m_pending.pop_front();
+    assignment.attempts++;
+    m_assigned[socket] = assignment;
+
+    socket->write(FarmProtocol::encodeChunk(assignment.chunk) + "\n");
+    socket->flush();
+}
+
+/**
+ * @brief Coordinator::retry - put a chunk back in the queue, unless it has used up its attempts
+ */
+void Coordinator::retry(Assignment assignment) {
+    if (assignment.attempts < m_maxAttempts) {
+        m_pending.push_back(assignment);
+
+        // a waiting worker can take it straight away
+        if (!m_waiting.empty()) {
+            QLocalSocket *socket = m_waiting.front();
+            m_waiting.pop_front();
+            assign(socket);
+        }
+        return;
+    }
+
+    std::cerr << "Giving up on chunk " << assignment.chunk.id << " after " << assignment.attempts << " attempts" << std::endl;
+    m_failed++;
+    finishChunk();
+}
+
+void Coordinator::finishChunk() {
+    if (--m_remaining > 0) {
+        return;
+    }
+
+    release();
+    if (m_onFinished) {
+        m_onFinished(m_failed);
+    }
+}
+
+/**
+ * @brief Coordinator::release - once there is nothing left to do, stop taking new workers and tell every connected
+ * worker to stop. Workers that haven't asked for a chunk yet find the answer waiting when they do.
+ */
+void Coordinator::release() {
+    m_server.close();
+    for (QLocalSocket *socket : m_connected) {
+        socket->write("DONE\n");
+        socket->flush();
+    }
+    m_waiting.clear();
+}
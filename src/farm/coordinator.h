@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include "farmprotocol.h"
+
+// Hands out chunks of frames to worker processes over a local socket. A chunk whose worker reports failure, or
+// disconnects before finishing it, goes back in the queue for another worker, up to a limited number of attempts.
+// Workers asking for a chunk while the queue is empty but others are still out wait for one of those to come back.
+// Once every chunk is done the coordinator stops accepting workers and tells every connected one to stop, whether it
+// has asked for a chunk yet or not. Runs on the Qt event loop.
+class Coordinator {
+public:
+    // Called once every chunk has either finished or run out of attempts
+    using FinishedCallback = std::function<void(int failedChunks)>;
+
+    Coordinator(const std::vector<std::vector<int>> &chunks, int maxAttempts, FinishedCallback onFinished);
+
+    // Starts accepting workers on the named local socket, replacing a stale socket left by a crashed coordinator
+    bool listen(const QString &name);
+
+    // The number of chunks that haven't finished or failed for good yet
+    int remaining() const;
+
+private:
+    struct Assignment {
+        FarmProtocol::Chunk chunk;
+        int attempts;
+    };
+
+    void accept();
+    void handleLine(QLocalSocket *socket, const QByteArray &line);
+    void assign(QLocalSocket *socket);
+    void retry(Assignment assignment);
+    void finishChunk();
+    void release();
+
+    QLocalServer m_server;
+    const int m_maxAttempts;
+    const FinishedCallback m_onFinished;
+
+    std::deque<Assignment> m_pending;
+    std::map<QLocalSocket *, Assignment> m_assigned;
+    std::set<QLocalSocket *> m_connected;
+    std::deque<QLocalSocket *> m_waiting; // Workers that asked for a chunk when there was none to give yet
+    int m_remaining;
+    int m_failed = 0;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <optional>
+#include <vector>
+
+// The line-based messages a coordinator and its workers exchange over a local socket:
+//   worker -> coordinator: "READY" (wants a chunk), "OK <id>" or "FAIL <id>" (finished a chunk)
+//   coordinator -> worker: "CHUNK <id> <frame> <frame>...", or "DONE" once every chunk is done. Until then, a worker
+//   asking while the other chunks are all out is left waiting, in case one of them comes back. DONE goes to every
+//   connected worker at once, so it may arrive before the worker has asked.
+namespace FarmProtocol {
+    struct Chunk {
+        int id = 0;
+        std::vector<int> frames;
+    };
+
+    inline QByteArray encodeChunk(const Chunk &chunk) {
+        QByteArray line = "CHUNK " + QByteArray::number(chunk.id);
+        for (int frame : chunk.frames) {
+            line += " " + QByteArray::number(frame);
+        }
+        return line;
+    }
+
+    inline std::optional<Chunk> decodeChunk(const QByteArray &line) {
+        QList<QByteArray> fields = line.split(' ');
+        if (fields.size() < 3 || fields[0] != "CHUNK") {
+            return std::nullopt;
+        }
+
+        Chunk chunk;
+        bool ok = false;
+        chunk.id = fields[1].toInt(&ok);
+        for (int i = 2; ok && i < fields.size(); i++) {
+            chunk.frames.push_back(fields[i].toInt(&ok));
+        }
+        return ok ? std::optional<Chunk>(chunk) : std::nullopt;
+    }
+}
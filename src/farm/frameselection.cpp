@@ -0,0 +1,96 @@
+#include "frameselection.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace FrameSelection {
+    /**
+     * @brief parseInt - parses a whole string as a non-negative integer
+     */
+    static bool parseInt(const std::string &text, int &value) {
+        if (text.empty() || text.size() > 9 || !std::all_of(text.begin(), text.end(), ::isdigit)) {
+            return false;
+        }
+        value = std::stoi(text);
+        return true;
+    }
+
+    /**
+     * @brief parseRange - parses a range of frame numbers
+     * @param text - "first-last", "first-" or "frame"
+     * @param numFrames - the number of frames in the animation
+     * @param first - set to the first frame of the range
+     * @param last - set to the last frame of the range, inclusive
+     * @return whether the text is a non-empty range within the animation
+     */
+    bool parseRange(const std::string &text, int numFrames, int &first, int &last) {
+        const std::size_t dash = text.find('-');
+        if (dash == std::string::npos) {
+            if (!parseInt(text, first)) {
+                return false;
+            }
+            last = first;
+        } else {
+            if (!parseInt(text.substr(0, dash), first)) {
+                return false;
+            }
+            const std::string end = text.substr(dash + 1);
+            if (end.empty()) {
+                last = numFrames - 1;
+            } else if (!parseInt(end, last)) {
+                return false;
+            }
+        }
+
+        return first <= last && last < numFrames;
+    }
+
+    /**
+     * @brief parseShard - parses a shard of a render
+     * @param text - "index/count", e.g. "3/16" for the fourth of sixteen shards
+     * @param index - set to the shard's index, from 0
+     * @param count - set to the number of shards
+     * @return whether the text is a valid shard
+     */
+    bool parseShard(const std::string &text, int &index, int &count) {
+        const std::size_t slash = text.find('/');
+        if (slash == std::string::npos) {
+            return false;
+        }
+        return parseInt(text.substr(0, slash), index) && parseInt(text.substr(slash + 1), count)
+                && count > 0 && index < count;
+    }
+
+    std::vector<int> select(int first, int last, int stride) {
+        std::vector<int> frames;
+        for (int frame = first; frame <= last; frame += std::max(stride, 1)) {
+            frames.push_back(frame);
+        }
+        return frames;
+    }
+
+    std::vector<int> shard(const std::vector<int> &frames, int index, int count) {
+        // long long keeps the products from overflowing on long clips split many ways
+        const std::size_t begin = std::size_t((long long)(frames.size()) * index / count);
+        const std::size_t end = std::size_t((long long)(frames.size()) * (index + 1) / count);
+        return std::vector<int>(frames.begin() + begin, frames.begin() + end);
+    }
+
+    std::vector<std::vector<int>> chunk(const std::vector<int> &frames, int chunkSize) {
+        std::vector<std::vector<int>> chunks;
+        for (std::size_t start = 0; start < frames.size(); start += std::max(chunkSize, 1)) {
+            const std::size_t end = std::min(frames.size(), start + std::max(chunkSize, 1));
+            chunks.emplace_back(frames.begin() + start, frames.begin() + end);
+        }
+        return chunks;
+    }
+
+    std::vector<int> spread(int numFrames, int count) {
+        std::vector<int> frames;
+        count = std::max(1, std::min(count, numFrames));
+        for (int i = 0; i < count; i++) {
+            frames.push_back(int(long(i) * numFrames / count));
+        }
+        return frames;
+    }
+}
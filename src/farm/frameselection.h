@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Picks which frames of an animation a run renders, so a clip can be split across several runs or machines. Frames
+// keep their number from the full animation, so output names don't depend on how the work was split.
+namespace FrameSelection {
+    // Parses a range of frames: "first-last" (inclusive), "first-" (through the end), or a single frame
+    // @return false if the text isn't a range inside [0, numFrames)
+    bool parseRange(const std::string &text, int numFrames, int &first, int &last);
+
+    // Parses a shard as "index/count", where index counts from 0
+    bool parseShard(const std::string &text, int &index, int &count);
+
+    // Every stride-th frame from first through last
+    std::vector<int> select(int first, int last, int stride);
+
+    // The index-th of count contiguous, evenly sized runs of frames. Contiguous runs keep consecutive frames in the
+    // same process, where incremental rendering and duplicate detection can take advantage of them.
+    std::vector<int> shard(const std::vector<int> &frames, int index, int count);
+
+    // Splits frames into contiguous chunks of at most chunkSize frames
+    std::vector<std::vector<int>> chunk(const std::vector<int> &frames, int chunkSize);
+
+    // count frames spread evenly over an animation of numFrames, always including the first. Used to sample a few
+    // frames of each scene when benchmarking or checking renders.
+    std::vector<int> spread(int numFrames, int count);
+}
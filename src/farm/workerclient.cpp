@@ -0,0 +1,38 @@
+#include "workerclient.h"
+
+bool WorkerClient::connectTo(const QString &name, int timeoutMs) {
+    m_socket.connectToServer(name);
+    return m_socket.waitForConnected(timeoutMs);
+}
+
+std::optional<FarmProtocol::Chunk> WorkerClient::nextChunk() {
+    if (!writeLine("READY")) {
+        return std::nullopt;
+    }
+
+    std::optional<QByteArray> line = readLine();
+    if (!line || *line == "DONE") {
+        return std::nullopt;
+    }
+    return FarmProtocol::decodeChunk(*line);
+}
+
+bool WorkerClient::report(int id, bool success) {
+    return writeLine((success ? "OK " : "FAIL ") + QByteArray::number(id));
+}
+
+bool WorkerClient::writeLine(const QByteArray &line) {
+    if (m_socket.write(line + "\n") < 0) {
+        return false;
+    }
+    return m_socket.waitForBytesWritten(-1) || m_socket.bytesToWrite() == 0;
+}
+
+std::optional<QByteArray> WorkerClient::readLine() {
+    while (!m_socket.canReadLine()) {
+        if (!m_socket.waitForReadyRead(-1)) {
+            return std::nullopt;
+        }
+    }
+    return m_socket.readLine().trimmed();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QLocalSocket>
+#include <optional>
+#include "farmprotocol.h"
+
+// The worker's end of a coordinator's socket. Blocks while waiting on the coordinator, so it needs no event loop.
+class WorkerClient {
+public:
+    // Connects to a coordinator
+    bool connectTo(const QString &name, int timeoutMs = 5000);
+
+    // Asks for the next chunk to render
+    // @return The chunk, or nothing once the coordinator has no work left (or has gone away).
+    std::optional<FarmProtocol::Chunk> nextChunk();
+
+    // Tells the coordinator whether every frame of a chunk was written
+    bool report(int id, bool success);
+
+private:
+    bool writeLine(const QByteArray &line);
+    std::optional<QByteArray> readLine();
+
+    QLocalSocket m_socket;
+};
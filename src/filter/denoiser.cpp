@@ -0,0 +1,134 @@
+#include "denoiser.h"
+
+#include "scratchpool.h"
+#include "utils/parallel.h"
+#include "utils/trace.h"
+#include <algorithm>
+#include <cmath>
+
+// The 1D B3-spline taps that the a-trous kernel is built from
+static const float KERNEL[5] = { 1.f / 16.f, 1.f / 4.f, 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+
+/**
+ * @brief edgeStop - turns a squared feature difference into a weight in (0, 1], falling off faster the smaller sigma is
+ */
+static float edgeStop(float squaredDifference, float sigma) {
+    return expf(-squaredDifference / (sigma * sigma));
+}
+
+/**
+ * @brief Denoiser::filterPass - runs one wavelet pass over the rows [rowStart, rowEnd) of the frame
+ * @param src - the colors produced by the previous pass
+ * @param dst - where to write the filtered colors
+ * @param frame - the frame being denoised (used for its dimensions)
+ * @param guides - the per-pixel surface features
+ * @param config - the denoiser settings
+ * @param stepSize - the distance in pixels between neighboring kernel taps for this pass
+ * @param sigmaColor - the color sigma for this pass
+ * @param rowStart - the first row to filter
+ * @param rowEnd - one past the last row to filter
+ */
+void Denoiser::filterPass(const glm::vec4 *src, glm::vec4 *dst, const FrameBuffer &frame, const AOV::Buffers &guides,
+                          const Config &config, int stepSize, float sigmaColor, int rowStart, int rowEnd) {
+    const int width = frame.width;
+    const int height = frame.height;
+
+    for (int row = rowStart; row < rowEnd; row++) {
+        for (int col = 0; col < width; col++) {
+            const int index = row * width + col;
+
+            const glm::vec4 &color = src[index];
+            const glm::vec3 &normal = guides.normal[index];
+            const glm::vec3 &albedo = guides.albedo[index];
+            const float depth = guides.hitT[index];
+            const bool hit = depth > 0.f;
+
+            glm::vec4 sum(0.f);
+            float weightSum = 0.f;
+
+            for (int j = -2; j <= 2; j++) {
+                const int qRow = row + j * stepSize;
+                if (qRow < 0 || qRow >= height) {
+                    continue;
+                }
+
+                for (int i = -2; i <= 2; i++) {
+                    const int qCol = col + i * stepSize;
+                    if (qCol < 0 || qCol >= width) {
+                        continue;
+                    }
+
+                    const int qIndex = qRow * width + qCol;
+                    const float qDepth = guides.hitT[qIndex];
+
+                    // never blur across the boundary between geometry and background
+                    if (hit != (qDepth > 0.f)) {
+                        continue;
+                    }
+
+                    const glm::vec4 &qColor = src[qIndex];
+                    glm::vec3 colorDiff = glm::vec3(qColor - color);
+
+                    float weight = KERNEL[i + 2] * KERNEL[j + 2]
+                            * edgeStop(glm::dot(colorDiff, colorDiff), sigmaColor);
+
+                    if (hit) {
+                        glm::vec3 normalDiff = guides.normal[qIndex] - normal;
+                        glm::vec3 albedoDiff = guides.albedo[qIndex] - albedo;
+                        float depthDiff = (qDepth - depth) / depth;
+
+                        weight *= edgeStop(glm::dot(normalDiff, normalDiff), config.sigmaNormal)
+                                * edgeStop(glm::dot(albedoDiff, albedoDiff), config.sigmaAlbedo)
+                                * edgeStop(depthDiff * depthDiff, config.sigmaDepth);
+                    }
+
+                    sum += weight * qColor;
+                    weightSum += weight;
+                }
+            }
+
+            // the center tap always has a weight of KERNEL[2]^2, so weightSum is never 0
+            dst[index] = sum / weightSum;
+            dst[index].a = color.a;
+        }
+    }
+}
+
+/**
+ * @brief Denoiser::apply - denoises a frame in place, using the given surface features to preserve edges
+ * @param frame - the frame to denoise
+ * @param guides - the surface features captured while rendering the frame
+ * @param config - the denoiser settings
+ * @param parallel - whether to filter bands of the frame concurrently
+ */
+void Denoiser::apply(FrameBuffer &frame, const AOV::Buffers &guides, const Config &config, bool parallel) {
+    if (config.iterations <= 0) {
+        return;
+    }
+    Trace::Span span("denoise");
+
+    ScratchPool::Buffer pingBuffer = ScratchPool::acquire(frame.size());
+    ScratchPool::Buffer pongBuffer = ScratchPool::acquire(frame.size());
+
+    const glm::vec4 *src = frame.data();
+    glm::vec4 *dst = pingBuffer.data();
+    glm::vec4 *spare = pongBuffer.data();
+
+    float sigmaColor = config.sigmaColor;
+    for (int pass = 0; pass < config.iterations; pass++) {
+        const int stepSize = 1 << pass;
+
+        // each pass reads its neighbors from the previous pass, so passes can't overlap
+        Parallel::forEachBand(frame.height, parallel, [&](int rowStart, int rowEnd) {
+            filterPass(src, dst, frame, guides, config, stepSize, sigmaColor, rowStart, rowEnd);
+        });
+
+        // the wider later passes only need to smooth what the earlier ones left behind
+        sigmaColor *= 0.5f;
+
+        src = dst;
+        std::swap(dst, spare);
+    }
+
+    std::copy(src, src + frame.size(), frame.data());
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "utils/framebuffer.h"
+#include "utils/aov.h"
+
+// An edge-avoiding a-trous wavelet denoiser (Dammertz et al. 2010). Each pass blurs with a sparse 5x5 B3-spline
+// kernel whose taps are spread twice as far apart as the previous pass, and each tap is weighted down by how much
+// its color, normal, albedo and depth differ from the center pixel, so that blurring stops at silhouettes and
+// texture edges.
+class Denoiser {
+public:
+    struct Config {
+        int   iterations  = 5;     // Number of wavelet passes; the footprint doubles with each one
+        float sigmaColor  = 0.5f;  // Color difference that begins to stop blurring (halved every pass)
+        float sigmaNormal = 0.3f;  // Normal difference that begins to stop blurring
+        float sigmaAlbedo = 0.1f;  // Albedo difference that begins to stop blurring
+        float sigmaDepth  = 0.05f; // Hit distance difference, relative to the center pixel's, that begins to stop blurring
+    };
+
+    // Denoises a frame in place. The guides must have (at least) the AOV::DENOISER_GUIDES channels.
+    static void apply(FrameBuffer &frame, const AOV::Buffers &guides, const Config &config, bool parallel = true);
+
+private:
+    static void filterPass(const glm::vec4 *src, glm::vec4 *dst, const FrameBuffer &frame, const AOV::Buffers &guides,
+                           const Config &config, int stepSize, float sigmaColor, int rowStart, int rowEnd);
+};
@@ -1,206 +1,181 @@
 #include "filter.h"
 
-#include "utils/colorutils.h"
+#include "scratchpool.h"
+#include "utils/parallel.h"
+#include "utils/trace.h"
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 Filter::Filter() { }
 
 /**
- * @brief createAccs - A templated function that creates the correct number of accumulators for a given convolution
- * @param accs - A vector of floats to be used as accumulators
+ * @brief reflectIndex - reflects an index over the edge of a row (or column) if it is out of bounds, the same way
+ * ColorUtils::getReflected does
+ * @param i - the index, possibly out of bounds
+ * @param size - the length of the row (or column)
+ * @return the reflected index, guaranteed to be in [0, size)
  */
-template <typename T>
-void createAccs(std::vector<float> &accs);
-
-/**
- * @brief createAccs - Creates 3 accumulators to keep track of R, G, and B values.
- * @param accs - A vector of floats
- */
-template <>
-void createAccs<RGBA>(std::vector<float> &accs) {
-    accs.clear();
-    accs.reserve(3);
-
-    accs.push_back(0.f);
-    accs.push_back(0.f);
-    accs.push_back(0.f);
-}
-
-/**
- * @brief createAccs - Creates one accumulator to keep track of intensity values
- * @param accs - A vector of floats.
- */
-template <>
-void createAccs<float>(std::vector<float> &accs) {
-    accs.clear();
-    accs.reserve(1);
+static int reflectIndex(int i, int size) {
+    if (i < 0) {
+        i = -i;
+    } else if (i >= size) {
+        i = (size - 1) - (i - size);
+    }
 
-    accs.push_back(0.f);
+    return std::clamp(i, 0, size - 1);
 }
 
-
-/**
- * @brief incrementAccs - A templated function that properly increments some accumulators based on the pixel type and kernel weight.
- * @param accs - A vector of floats representing the accumulator values
- * @param addition - The value you want to add to the accumulators.
- * @param coefficient - The coeefficent you want to multiply the added values by when updated the accumulators.
- */
-template <typename T>
-void incrementAccs(std::vector<float> &accs, const T &addition, float coefficient);
-
 /**
- * @brief incrementAccs - Updates the three accumulators based on the RGB values of a pixel and some coefficient
- * @param accs - A vector of three floats representing the R, G, and B accumulated values
- * @param addition - Some RGBA pixel
- * @param coefficient - The weight of the kernel
+ * @brief toVec4 - widens a pixel of the given type into the 4-float form the filter engine works in
  */
-template <>
-void incrementAccs<RGBA>(std::vector<float> &accs, const RGBA &addition, float coefficient) {
-    accs[0] += coefficient * addition.r;
-    accs[1] += coefficient * addition.g;
-    accs[2] += coefficient * addition.b;
+static glm::vec4 toVec4(const RGBA &pixel) {
+    return { pixel.r, pixel.g, pixel.b, 255.f };
 }
 
-/**
- * @brief incrementAccs - Updates one accumulator based on the intensity value of a pixel and some coefficient
- * @param accs - A vector of a single float representing the accumulation of intensity values
- * @param addition - Some pixel intensity
- * @param coefficient - The weight of the kernel
- */
-template <>
-void incrementAccs<float>(std::vector<float> &accs, const float &addition, float coefficient) {
-    accs[0] += coefficient * addition;
+static glm::vec4 toVec4(const glm::vec4 &pixel) {
+    return pixel;
 }
 
 /**
- * @brief createPixel - Templated function taht, given some accumulators, this returns the proper type of pixel created from those accumulators
- * @param accs - The accumulators from which to create the pixel
- * @return Some type of pixel based ont eh accumulators
+ * @brief fromVec4 - narrows a filtered pixel back into the type of the image being filtered
  */
 template <typename T>
-T createPixel(const std::vector<float> &accs);
+static T fromVec4(const glm::vec4 &pixel);
 
-/**
- * @brief createPixel - Creates an RGBA pixel based on 3 accumulators
- * @param accs - A vector of floats representing the desired R, G, and B values
- * @return An RGBA value based on the accumulators.
- */
 template <>
-RGBA createPixel(const std::vector<float> &accs) {
-    std::uint8_t redVal = accs[0];
-    std::uint8_t greenVal = accs[1];
-    std::uint8_t blueVal = accs[2];
+RGBA fromVec4<RGBA>(const glm::vec4 &pixel) {
+    glm::vec4 clamped = glm::clamp(pixel, 0.f, 255.f);
 
-    return { redVal, greenVal, blueVal, 255 };
+    return { std::uint8_t(clamped.r), std::uint8_t(clamped.g), std::uint8_t(clamped.b), 255 };
 }
 
-/**
- * @brief createPixel - Creates an intensity pixel based on a single accumulator
- * @param accs - A vector of floats containing a single float representing the intensity of the pixel
- * @return A float value representing the intensity of a pixel
- */
 template <>
-float createPixel(const std::vector<float> &accs) {
-    return accs[0];
+glm::vec4 fromVec4<glm::vec4>(const glm::vec4 &pixel) {
+    return pixel;
 }
 
 /**
- * @brief Filter::convolveHorizontal - A templated function taking in either an image of RGBA data or an image of float intensity data, convolves the original image by the
- * given kernel and saves the resul in the result vector. Only convolves the rows.
- * @param data - The data of the original image either vector or RGBA or vector of float values.
+ * @brief Filter::convolveHorizontal - convolves the rows [rowStart, rowEnd) of an image by the given kernel and saves
+ * the result (at full precision) in the same rows of result. Each row is first copied into a padded scratch row with
+ * its edges reflected, so the inner loop never has to check bounds.
+ * @param data - The data of the original image
  * @param width - The width of the image
- * @param height - The height of the image
- * @param result - The vector in which to store the convolved image.
+ * @param rowStart - The first row to convolve
+ * @param rowEnd - One past the last row to convolve
+ * @param result - A width * height buffer in which to store the convolved rows
  * @param horizontalKernel - Some vector by which to horizontally convolve the image.
  */
 template <typename T>
-void Filter::convolveHorizontal(const T *data, int width, int height, T *result, const std::vector<float> &horizontalKernel) {
-    int lastKernelIndex = horizontalKernel.size() - 1;
-    int kernelRadius = horizontalKernel.size() / 2;
+void Filter::convolveHorizontal(const T *data, int width, int rowStart, int rowEnd, glm::vec4 *result, const std::vector<float> &horizontalKernel) {
+    const int kernelSize = horizontalKernel.size();
+    const int kernelRadius = kernelSize / 2;
 
-    // create the proper number of accumulators based on the type
-    std::vector<float> accs;
-    createAccs<T>(accs);
+    // index the kernel from back to front to similate rotating 180 degrees.
+    std::vector<float> kernel(horizontalKernel.rbegin(), horizontalKernel.rend());
 
-    int index = 0;
-    for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            // zero out the accumulators
-            for (float& acc : accs) {
-                acc = 0.f;
-            }
+    ScratchPool::Buffer paddedBuffer = ScratchPool::acquire(width + 2 * kernelRadius);
+    glm::vec4 *padded = paddedBuffer.data();
 
-            // index the kernel from back to front to similate rotating 180 degrees.
-            int kernelIndex = lastKernelIndex;
+    for (int row = rowStart; row < rowEnd; row++) {
+        const T *src = data + row * width;
 
-             // move left and right around the center pixel
-            for (int colOffset = -kernelRadius; colOffset <= kernelRadius; ++colOffset) {
-                float curKernelWeight = horizontalKernel[kernelIndex];
-                int relCol = col + colOffset;
-
-                // get the color (or intensity) data at this pixel, reflecting if out of bounds
-                const T &curColor = ColorUtils::getReflected<T>(data, row, relCol, width, height);
+        // widen the row into the padded buffer, reflecting over the edges once up front
+        for (int col = 0; col < width; col++) {
+            padded[kernelRadius + col] = toVec4(src[col]);
+        }
+        for (int col = -kernelRadius; col < 0; col++) {
+            padded[kernelRadius + col] = toVec4(src[reflectIndex(col, width)]);
+        }
+        for (int col = width; col < width + kernelRadius; col++) {
+            padded[kernelRadius + col] = toVec4(src[reflectIndex(col, width)]);
+        }
 
-                // update the accumulators with this new color data
-                incrementAccs<T>(accs, curColor, curKernelWeight);
+        glm::vec4 *dst = result + row * width;
+        for (int col = 0; col < width; col++) {
+            const glm::vec4 *window = padded + col;
 
-                --kernelIndex;
+            glm::vec4 acc(0.f);
+            for (int k = 0; k < kernelSize; k++) {
+                acc += kernel[k] * window[k];
             }
 
-            // add the new pixel defined by the accumulators to the result image.
-            T newPixel = createPixel<T>(accs);
-            result[index++] = newPixel;
+            dst[col] = acc;
         }
     }
 }
 
 /**
- * @brief Filter::convolveVector - A templated function taking in either an image of RGBA data or an image of float intensity data, convolves the original image by the
- * given kernel and saves the resul in the result vector. Only convolves the columns.
- * @param data - The data of the original image either vector or RGBA or vector of float values.
+ * @brief Filter::convolveVertical - convolves the rows [rowStart, rowEnd) of an already horizontally convolved image by
+ * the given kernel and saves the result in the same rows of result. The source rows for each output row are looked up
+ * (and reflected) once, after which every kernel tap is a straight pass over a contiguous row.
+ * @param data - The horizontally convolved image
  * @param width - The width of the image
  * @param height - The height of the image
- * @param result - The vector in which to store the convolved image.
+ * @param rowStart - The first row to convolve
+ * @param rowEnd - One past the last row to convolve
+ * @param result - The image in which to store the convolved rows.
  * @param verticalKernel - Some vector by which to vertically convolve the image.
  */
 template <typename T>
-void Filter::convolveVertical(const T* data, int width, int height, T *result, const std::vector<float> &verticalKernel) {
-    int lastKernelIndex = verticalKernel.size() - 1;
-    int kernelRadius = verticalKernel.size() / 2;
-
-    // create the proper number of accumulators based on the type
-    std::vector<float> accs;
-    createAccs<T>(accs);
+void Filter::convolveVertical(const glm::vec4 *data, int width, int height, int rowStart, int rowEnd, T *result, const std::vector<float> &verticalKernel) {
+    const int kernelSize = verticalKernel.size();
+    const int kernelRadius = kernelSize / 2;
 
-    int index = 0;
-    for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            // zero out the accumulators
-            for (float& acc : accs) {
-                acc = 0.f;
-            }
+    // index the kernel from back to front to similate rotating 180 degrees.
+    std::vector<float> kernel(verticalKernel.rbegin(), verticalKernel.rend());
+    std::vector<const glm::vec4 *> srcRows(kernelSize);
 
-            // index the kernel from back to front to similate rotating 180 degrees.
-            int kernelIndex = lastKernelIndex;
+    ScratchPool::Buffer accBuffer = ScratchPool::acquire(width);
+    glm::vec4 *acc = accBuffer.data();
 
-            // move up and down around the center pixel
-            for (int rowOffset = -kernelRadius; rowOffset <= kernelRadius; ++rowOffset) {
-                float curKernelWeight = verticalKernel[kernelIndex];
-                int relRow = row + rowOffset;
+    for (int row = rowStart; row < rowEnd; row++) {
+        // find the rows above and below the center row, reflecting if out of bounds
+        for (int k = 0; k < kernelSize; k++) {
+            srcRows[k] = data + reflectIndex(row - kernelRadius + k, height) * width;
+        }
 
-                // get the color (or intensity) data at this pixel, reflecting if out of bounds
-                const T &curColor = ColorUtils::getReflected<T>(data, relRow, col, width, height);
-                incrementAccs<T>(accs, curColor, curKernelWeight);
+        std::fill(acc, acc + width, glm::vec4(0.f));
+        for (int k = 0; k < kernelSize; k++) {
+            const float weight = kernel[k];
+            const glm::vec4 *src = srcRows[k];
 
-                --kernelIndex;
+            for (int col = 0; col < width; col++) {
+                acc[col] += weight * src[col];
             }
+        }
 
-            T newPixel = createPixel<T>(accs);
-            result[index++] = newPixel;
+        T *dst = result + row * width;
+        for (int col = 0; col < width; col++) {
+            dst[col] = fromVec4<T>(acc[col]);
         }
     }
 }
 
+/**
+ * @brief Filter::applySeparable - convolves an image in place by a separable kernel, first along the rows and then
+ * along the columns. The intermediate image lives in a pooled heap buffer.
+ * @param image - The image to filter
+ * @param width - The width of the image
+ * @param height - The height of the image
+ * @param kernel - The 1D kernel, applied in both directions
+ * @param parallel - Whether to filter bands of rows concurrently
+ */
+template <typename T>
+void Filter::applySeparable(T *image, int width, int height, const std::vector<float> &kernel, bool parallel) {
+    ScratchPool::Buffer intermediateBuffer = ScratchPool::acquire(width * height);
+    glm::vec4 *intermediate = intermediateBuffer.data();
+
+    // the vertical pass reads rows from neighboring bands, so every band must finish its horizontal pass first
+    Parallel::forEachBand(height, parallel, [&](int rowStart, int rowEnd) {
+        convolveHorizontal<T>(image, width, rowStart, rowEnd, intermediate, kernel);
+    });
+
+    Parallel::forEachBand(height, parallel, [&](int rowStart, int rowEnd) {
+        convolveVertical<T>(intermediate, width, height, rowStart, rowEnd, image, kernel);
+    });
+}
+
 /**
  * @brief triangleValueAt - given some radius and some x, this computes the proper result of the triangle function at x
  * @param x - the position in the triangle function
@@ -239,15 +214,29 @@ void fillTriangleKernel(std::vector<float> &kernel, int radius) {
  * @param image - the input image to blue
  * @param width - the width of the image
  * @param height - the height of the image
+ * @param radius - the radius of the triangle kernel
+ * @param parallel - whether to filter bands of the image concurrently
  */
-void Filter::applyBlur(RGBA *image, int width, int height, int radius) {
+void Filter::applyBlur(RGBA *image, int width, int height, int radius, bool parallel) {
+    Trace::Span span("blur");
     std::vector<float> triangleKernel;
     fillTriangleKernel(triangleKernel, radius);
 
-    // first horizontally convolve the original image
-    RGBA horizontalBlur[height][width];
-    convolveHorizontal<RGBA>(image, width, height, &horizontalBlur[0][0], triangleKernel);
+    applySeparable<RGBA>(image, width, height, triangleKernel, parallel);
+}
+
+/**
+ * @brief Filter::applyBlur - apply the blur filter to a floating-point image, without quantizing any of its values
+ * @param image - the input image to blur
+ * @param width - the width of the image
+ * @param height - the height of the image
+ * @param radius - the radius of the triangle kernel
+ * @param parallel - whether to filter bands of the image concurrently
+ */
+void Filter::applyBlur(glm::vec4 *image, int width, int height, int radius, bool parallel) {
+    Trace::Span span("blur");
+    std::vector<float> triangleKernel;
+    fillTriangleKernel(triangleKernel, radius);
 
-    // then vertically blur the result of the first convolution and save it in the original image
-    convolveVertical<RGBA>(&horizontalBlur[0][0], width, height, image, triangleKernel);
+    applySeparable<glm::vec4>(image, width, height, triangleKernel, parallel);
 }
@@ -2,19 +2,24 @@
 #define FILTER_H
 
 #include <vector>
+#include <glm/glm.hpp>
 #include "utils/rgba.h"
 
 class Filter {
 public:
     Filter();
 
-    static void applyBlur(RGBA *image, int width, int height, int radius);
+    static void applyBlur(RGBA *image, int width, int height, int radius, bool parallel = true);
+    static void applyBlur(glm::vec4 *image, int width, int height, int radius, bool parallel = true);
 private:
     template <typename T>
-    static void convolveHorizontal(const T *data, int width, int height, T *result, const std::vector<float> &horizontalKernel);
+    static void convolveHorizontal(const T *data, int width, int rowStart, int rowEnd, glm::vec4 *result, const std::vector<float> &horizontalKernel);
 
     template <typename T>
-    static void convolveVertical(const T* data, int width, int height, T *result, const std::vector<float> &verticalKernel);
+    static void convolveVertical(const glm::vec4 *data, int width, int height, int rowStart, int rowEnd, T *result, const std::vector<float> &verticalKernel);
+
+    template <typename T>
+    static void applySeparable(T *image, int width, int height, const std::vector<float> &kernel, bool parallel);
 };
 
 #endif // FILTER_H
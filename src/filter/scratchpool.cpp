@@ -0,0 +1,71 @@
+#include "scratchpool.h"
+
+#include <utility>
+
+std::mutex ScratchPool::s_mutex;
+std::vector<std::vector<glm::vec4>> ScratchPool::s_free;
+
+ScratchPool::Buffer::Buffer(std::vector<glm::vec4> &&storage) :
+    m_storage(std::move(storage))
+{}
+
+ScratchPool::Buffer::~Buffer() {
+    // moved-from buffers have nothing left to give back
+    if (!m_storage.empty()) {
+        ScratchPool::release(std::move(m_storage));
+    }
+}
+
+/**
+ * @brief ScratchPool::Buffer::data - get a pointer to the first element of the borrowed buffer
+ */
+glm::vec4 *ScratchPool::Buffer::data() {
+    return m_storage.data();
+}
+
+/**
+ * @brief ScratchPool::acquire - borrow the smallest pooled buffer that can hold size elements, allocating a new one
+ * if none of the pooled buffers are large enough
+ * @param size - the number of elements the caller needs
+ * @return A buffer which is handed back to the pool when it is destroyed
+ */
+ScratchPool::Buffer ScratchPool::acquire(std::size_t size) {
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+
+        auto best = s_free.end();
+        for (auto it = s_free.begin(); it != s_free.end(); ++it) {
+            if (it->size() >= size && (best == s_free.end() || it->size() < best->size())) {
+                best = it;
+            }
+        }
+
+        if (best != s_free.end()) {
+            std::vector<glm::vec4> storage = std::move(*best);
+            s_free.erase(best);
+            return Buffer(std::move(storage));
+        }
+    }
+
+    // allocate outside the lock; never hand out an empty vector so the buffer is always returned
+    return Buffer(std::vector<glm::vec4>(size > 0 ? size : 1));
+}
+
+/**
+ * @brief ScratchPool::release - return a buffer to the pool, dropping the smallest buffer if the pool is full
+ * @param storage - the storage of a buffer that is no longer in use
+ */
+void ScratchPool::release(std::vector<glm::vec4> &&storage) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_free.push_back(std::move(storage));
+
+    if (s_free.size() > MAX_POOLED) {
+        auto smallest = s_free.begin();
+        for (auto it = s_free.begin(); it != s_free.end(); ++it) {
+            if (it->size() < smallest->size()) {
+                smallest = it;
+            }
+        }
+        s_free.erase(smallest);
+    }
+}
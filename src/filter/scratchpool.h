@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include <glm/glm.hpp>
+
+// A process-wide pool of heap-allocated scratch buffers. Filter passes borrow a buffer for the duration
+// of a pass and hand it back afterwards, so large intermediates never live on a thread's stack and
+// consecutive frames reuse the same allocations.
+class ScratchPool {
+public:
+    // A borrowed buffer, returned to the pool when it goes out of scope
+    class Buffer {
+    public:
+        explicit Buffer(std::vector<glm::vec4> &&storage);
+        Buffer(Buffer &&other) = default;
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+        ~Buffer();
+
+        glm::vec4 *data();
+
+    private:
+        std::vector<glm::vec4> m_storage;
+    };
+
+    // Borrows a buffer that holds at least `size` elements. Its contents are unspecified.
+    static Buffer acquire(std::size_t size);
+
+private:
+    static void release(std::vector<glm::vec4> &&storage);
+
+    // The most buffers kept around between passes; anything beyond this is freed.
+    static const std::size_t MAX_POOLED = 16;
+
+    static std::mutex s_mutex;
+    static std::vector<std::vector<glm::vec4>> s_free;
+};
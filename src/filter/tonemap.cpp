@@ -0,0 +1,108 @@
+#include "tonemap.h"
+
+#include "utils/parallel.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace ToneMap {
+    // The resolution of the sRGB encoding table. 12 bits is finer than any step an 8-bit output can show.
+    static const int SRGB_LUT_SIZE = 4096;
+
+    /**
+     * @brief srgbEncode - applies the sRGB transfer function to a linear value in [0, 1]
+     */
+    static float srgbEncode(float linear) {
+        if (linear <= 0.0031308f) {
+            return 12.92f * linear;
+        }
+
+        return 1.055f * powf(linear, 1.f / 2.4f) - 0.055f;
+    }
+
+    /**
+     * @brief srgbTable - a lookup table from a quantized linear value in [0, 1] to its 8-bit sRGB encoding, so that
+     * the per-pixel cost of sRGB output is a single load instead of a pow
+     */
+    static const std::array<std::uint8_t, SRGB_LUT_SIZE> &srgbTable() {
+        static const std::array<std::uint8_t, SRGB_LUT_SIZE> table = [] {
+            std::array<std::uint8_t, SRGB_LUT_SIZE> t;
+            for (int i = 0; i < SRGB_LUT_SIZE; i++) {
+                t[i] = (std::uint8_t) std::lround(255.f * srgbEncode(i / float(SRGB_LUT_SIZE - 1)));
+            }
+            return t;
+        }();
+
+        return table;
+    }
+
+    /**
+     * @brief mapChannel - applies the tone mapping operator to a single exposed channel value
+     * @return the mapped value in [0, 1]
+     */
+    static float mapChannel(float c, Operator op) {
+        switch (op) {
+            case Operator::REINHARD:
+                c = std::max(c, 0.f);
+                return c / (1.f + c);
+            case Operator::ACES:
+                c = std::max(c, 0.f);
+                return std::clamp((c * (2.51f * c + 0.03f)) / (c * (2.43f * c + 0.59f) + 0.14f), 0.f, 1.f);
+            case Operator::CLAMP:
+            default:
+                return std::clamp(c, 0.f, 1.f);
+        }
+    }
+
+    /**
+     * @brief parseOperator - looks up a tone mapping operator by the name used in config files
+     * @param name - one of "clamp", "reinhard", or "aces"
+     * @param op - set to the matching operator on success
+     * @return whether the name was recognized
+     */
+    bool parseOperator(const std::string &name, Operator &op) {
+        if (name == "clamp" || name.empty()) {
+            op = Operator::CLAMP;
+        } else if (name == "reinhard") {
+            op = Operator::REINHARD;
+        } else if (name == "aces") {
+            op = Operator::ACES;
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief apply - quantizes a floating-point frame to 8-bit color, applying exposure, the tone mapping operator and
+     * (optionally) the sRGB transfer function on the way
+     * @param frame - the frame to convert
+     * @param output - a buffer of frame.size() pixels to write to
+     * @param config - how to map the frame
+     * @param parallel - whether to convert bands of the frame concurrently
+     */
+    void apply(const FrameBuffer &frame, RGBA *output, const Config &config, bool parallel) {
+        const auto &table = srgbTable();
+
+        auto quantize = [&](float c) -> std::uint8_t {
+            float mapped = mapChannel(c * config.exposure, config.op);
+
+            if (config.srgb) {
+                return table[int(mapped * (SRGB_LUT_SIZE - 1) + 0.5f)];
+            }
+
+            // truncate, like ColorUtils::toRGBA, so linear clamped output matches the original renderer exactly when
+            // post-processing is off. With it on, the blur now runs on unquantized radiance, so edges can differ.
+            return (std::uint8_t) (255 * mapped);
+        };
+
+        Parallel::forEachBand(frame.height, parallel, [&](int rowStart, int rowEnd) {
+            for (int i = rowStart * frame.width; i < rowEnd * frame.width; i++) {
+                const glm::vec4 &pixel = frame.pixels[i];
+                output[i] = RGBA{ quantize(pixel.r), quantize(pixel.g), quantize(pixel.b) };
+            }
+        });
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include "utils/framebuffer.h"
+#include "utils/rgba.h"
+
+// Converts linear floating-point frames into displayable 8-bit color
+namespace ToneMap {
+    enum class Operator {
+        CLAMP,    // Clip each channel to [0, 1]
+        REINHARD, // c / (1 + c)
+        ACES      // Narkowicz's fit of the ACES filmic curve
+    };
+
+    struct Config {
+        Operator op     = Operator::CLAMP;
+        float exposure  = 1.f;   // Multiplier applied before the operator
+        bool  srgb      = false; // Encode with the sRGB transfer function instead of storing linear values
+    };
+
+    bool parseOperator(const std::string &name, Operator &op);
+    void apply(const FrameBuffer &frame, RGBA *output, const Config &config, bool parallel = true);
+}
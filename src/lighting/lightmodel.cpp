@@ -1,4 +1,5 @@
 #include "lightmodel.h"
+#include "utils/stats.h"
 
 #include <cmath>
 #include <iostream>
@@ -31,6 +32,7 @@ glm::vec4 phong(
     glm::vec4 ambient = globals.ka * material.cAmbient;
     illumination += ambient;
 
+    SKIPPY_STAT(LIGHTS_EVALUATED, lights.size());
     for (auto& light : lights) {
         auto [ lightToIntersect, lightColor, visible ] = light(position, prims, enableShadow);
 
@@ -1,13 +1,44 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
-#include <QImage>
+#include <QProcess>
 #include <QtCore>
 #include <QtConcurrent>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <future>
 #include <iostream>
-#include "utils/sceneparser.h"
+#include <memory>
+#include <optional>
+#include "core/skippy.h"
 #include "raytracer/raytracer.h"
 #include "raytracer/raytracescene.h"
+#include "raytracer/incrementalrenderer.h"
+#include "raytracer/scenehash.h"
+#include "filter/tonemap.h"
+#include "output/imagewriter.h"
+#include "output/scanlinewriter.h"
+#include "output/atomicfile.h"
+#include "output/checkpoint.h"
+#include "output/encoderpipeline.h"
+#include "output/framecache.h"
+#include "output/framewriter.h"
+#include "output/gifwriter.h"
+#include "output/heatmap.h"
+#include "output/rendermanifest.h"
+#include "output/statswriter.h"
+#include "output/reorderbuffer.h"
+#include "output/videostream.h"
+#include "farm/frameselection.h"
+#include "farm/coordinator.h"
+#include "farm/workerclient.h"
+#include "server/renderserver.h"
+#include "texture/texture.h"
+#include "utils/aov.h"
+#include "utils/rendersettings.h"
+#include "utils/trace.h"
 
 
 int main(int argc, char *argv[])
@@ -19,8 +50,21 @@ int main(int argc, char *argv[])
     QCommandLineParser parser;
     parser.addHelpOption();
     parser.addPositionalArgument("config", "Path of the config file.");
+    QCommandLineOption resumeOption("resume", "Skip the frames an interrupted render already finished, and carry on from any checkpointed rows.");
+    QCommandLineOption framesOption("frames", "Only render the frames in a range, e.g. 100-199, 100- or 100.", "range");
+    QCommandLineOption strideOption("stride", "Only render every n-th frame of the range.", "n", "1");
+    QCommandLineOption shardOption("shard", "Only render one of several equal, contiguous shards of the frames, e.g. 3/16 (counting from 0).", "index/count");
+    QCommandLineOption coordinateOption("coordinate", "Hand the frames out in chunks to worker processes connecting to a local socket, instead of rendering them.", "socket");
+    QCommandLineOption spawnOption("spawn", "When coordinating, also start this many local worker processes.", "n", "0");
+    QCommandLineOption chunkSizeOption("chunk-size", "When coordinating, the number of frames handed out at a time.", "n", "8");
+    QCommandLineOption workerOption("worker", "Render the chunks of frames handed out by a coordinator on a local socket.", "socket");
+    QCommandLineOption serveOption("serve", "Stay running and render the jobs sent to a local socket, keeping scenes and textures loaded between them.", "socket");
+    QCommandLineOption traceOption("trace", "Write a timeline of the render as Chrome trace events, for chrome://tracing or Perfetto.", "file");
+    parser.addOptions({ resumeOption, framesOption, strideOption, shardOption, coordinateOption, spawnOption, chunkSizeOption, workerOption, serveOption, traceOption });
     parser.process(a);
 
+    const bool resume = parser.isSet(resumeOption);
+
     auto positionalArgs = parser.positionalArguments();
     if (positionalArgs.size() != 1) {
         std::cerr << "Not enough arguments. Please provide a path to a config file (.ini) as a command-line argument." << std::endl;
@@ -28,21 +72,143 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    // A server takes its scene and settings from each job, falling back on the config file for anything left out
+    if (parser.isSet(serveOption)) {
+        const QString socketName = parser.value(serveOption);
+        QSettings serverSettings( positionalArgs[0], QSettings::IniFormat );
+
+        RenderServer server(positionalArgs[0], serverSettings.value("Server/max-scenes", 4).toInt());
+        Texture::setCacheLimit(std::size_t(std::max(serverSettings.value("Server/max-texture-mb", 512).toInt(), 0)) << 20);
+        if (!server.listen(socketName)) {
+            std::cerr << "Error: failed to listen on \"" << socketName.toStdString() << "\"" << std::endl;
+            a.exit(1);
+            return 1;
+        }
+        std::cout << "Waiting for render jobs on \"" << socketName.toStdString() << "\"" << std::endl;
+        return a.exec();
+    }
+
     QSettings settings( positionalArgs[0], QSettings::IniFormat );
     QString iScenePath = settings.value("IO/scene").toString();
     QString oImagePath = settings.value("IO/output").toString();
 
+    // When the video is streamed to stdout, progress messages have to go somewhere else
+    if (settings.value("Stream/mode").toString() == "y4m" && settings.value("Stream/path").toString() == "-") {
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
+    if (parser.isSet(traceOption)) {
+        Trace::start(parser.value(traceOption).toStdString());
+        Trace::nameThread("main");
+    }
+
     std::cout << "Parsing the scene" << std::endl;
 
-    std::vector<RenderData*> metaData;
-    bool success = SceneParser::parse(iScenePath.toStdString(), metaData);
+    std::shared_ptr<const Skippy::Scene> scene = Skippy::Scene::load(iScenePath.toStdString());
 
-    if (!success) {
+    if (!scene) {
         std::cerr << "Error loading scene: \"" << iScenePath.toStdString() << "\"" << std::endl;
         a.exit(1);
         return 1;
     }
 
+    // Pick the frames this run is responsible for; they keep their numbers from the full animation
+    const int numFrames = scene->frameCount();
+    int firstFrame = 0;
+    int lastFrame = numFrames - 1;
+    if (parser.isSet(framesOption) && !FrameSelection::parseRange(parser.value(framesOption).toStdString(), numFrames, firstFrame, lastFrame)) {
+        std::cerr << "Invalid frame range \"" << parser.value(framesOption).toStdString() << "\" for an animation of " << numFrames << " frames" << std::endl;
+        a.exit(1);
+        return 1;
+    }
+    std::vector<int> frames = FrameSelection::select(firstFrame, lastFrame, parser.value(strideOption).toInt());
+
+    int shardIndex = 0;
+    int shardCount = 1;
+    if (parser.isSet(shardOption)) {
+        if (!FrameSelection::parseShard(parser.value(shardOption).toStdString(), shardIndex, shardCount)) {
+            std::cerr << "Invalid shard \"" << parser.value(shardOption).toStdString() << "\"; expected index/count, e.g. 3/16" << std::endl;
+            a.exit(1);
+            return 1;
+        }
+        frames = FrameSelection::shard(frames, shardIndex, shardCount);
+        std::cout << "Rendering shard " << shardIndex << " of " << shardCount << ": " << frames.size() << " frame(s)" << std::endl;
+    }
+
+    const bool isWorker = parser.isSet(workerOption);
+    const bool isFarm = isWorker || parser.isSet(coordinateOption);
+    if (isFarm && settings.value("Stream/mode", "none").toString() != "none") {
+        std::cerr << "Streamed renders can't be split between workers, since the stream needs every frame in one place" << std::endl;
+        a.exit(1);
+        return 1;
+    }
+
+    // A coordinator only hands out work: each chunk goes to whichever worker asks next, and is handed out again if
+    // the worker fails or dies
+    if (parser.isSet(coordinateOption)) {
+        const QString socketName = parser.value(coordinateOption);
+        int failedChunks = 0;
+        int runningWorkers = parser.value(spawnOption).toInt();
+
+        // the workers started here are only waited for once every chunk is done, so the loop keeps running until
+        // they have all been told to stop and exited
+        Coordinator coordinator(FrameSelection::chunk(frames, parser.value(chunkSizeOption).toInt()), 3, [&](int failed) {
+            failedChunks = failed;
+            if (runningWorkers == 0) {
+                a.exit(failed > 0 ? 1 : 0);
+            }
+        });
+        if (coordinator.remaining() == 0) {
+            std::cout << "No frames to coordinate" << std::endl;
+            a.exit();
+            return 0;
+        }
+        if (!coordinator.listen(socketName)) {
+            std::cerr << "Error: failed to listen on \"" << socketName.toStdString() << "\"" << std::endl;
+            a.exit(1);
+            return 1;
+        }
+        std::cout << "Coordinating " << frames.size() << " frame(s) on \"" << socketName.toStdString() << "\"" << std::endl;
+
+        // workers started here render with the same config, and stop once the coordinator runs out of chunks
+        std::vector<std::unique_ptr<QProcess>> workers;
+        auto workerExited = [&]() {
+            if (--runningWorkers > 0) {
+                return;
+            }
+            if (coordinator.remaining() > 0) {
+                std::cerr << "Every worker exited with " << coordinator.remaining() << " chunk(s) left" << std::endl;
+                a.exit(1);
+            } else {
+                a.exit(failedChunks > 0 ? 1 : 0);
+            }
+        };
+        const int spawnedWorkers = runningWorkers;
+        for (int i = 0; i < spawnedWorkers; i++) {
+            auto worker = std::make_unique<QProcess>();
+            worker->setProcessChannelMode(QProcess::ForwardedChannels);
+            QObject::connect(worker.get(), &QProcess::finished, [&](int, QProcess::ExitStatus) { workerExited(); });
+
+            // a worker that never started won't finish either
+            QObject::connect(worker.get(), &QProcess::errorOccurred, [&](QProcess::ProcessError error) {
+                if (error == QProcess::FailedToStart) {
+                    workerExited();
+                }
+            });
+            worker->start(QCoreApplication::applicationFilePath(), { "--worker", socketName, positionalArgs[0] });
+            workers.push_back(std::move(worker));
+        }
+
+        int result = a.exec();
+        for (auto &worker : workers) {
+            worker->waitForFinished(-1);
+        }
+        if (failedChunks > 0) {
+            std::cerr << failedChunks << " chunk(s) could not be rendered" << std::endl;
+        }
+        return result;
+    }
+
     // Raytracing-relevant code starts here
 
     int width = settings.value("Canvas/width").toInt();
@@ -50,49 +216,612 @@ int main(int argc, char *argv[])
 
 
     // Setting up the raytracer
-    RayTracer::Config rtConfig{};
-    rtConfig.enableShadow        = settings.value("Feature/shadows").toBool();
-    rtConfig.enableReflection    = settings.value("Feature/reflect").toBool();
-    rtConfig.enableRefraction    = settings.value("Feature/refract").toBool();
-    rtConfig.enableTextureMap    = settings.value("Feature/texture").toBool();
-    rtConfig.enableTextureFilter = settings.value("Feature/texture-filter").toBool();
-    rtConfig.enableParallelism   = settings.value("Feature/parallel").toBool();
-    rtConfig.enableSuperSample   = settings.value("Feature/super-sample").toBool();
-    rtConfig.numSamples          = settings.value("Feature/num-samples").toInt();
-    rtConfig.enablePostProcess   = settings.value("Feature/post-process").toBool();
-    rtConfig.enableAcceleration  = settings.value("Feature/acceleration").toBool();
-    rtConfig.enableDepthOfField  = settings.value("Feature/depthoffield").toBool();
+    const RenderSettings::Lookup settingValue = RenderSettings::from(settings);
+    RayTracer::Config rtConfig = RenderSettings::rayTracerConfig(settingValue);
+
+    // Setting up the output
+    QString oFormat = settings.value("Output/format", "png").toString();
+    if (!FrameWriter::isFormat(oFormat.toStdString())) {
+        std::cerr << "Unknown output format: \"" << oFormat.toStdString() << "\"" << std::endl;
+        a.exit(1);
+        return 1;
+    }
+    const bool floatFormat = FrameWriter::isFloat(oFormat.toStdString());
+
+    ToneMap::Config toneMapConfig{};
+    if (!RenderSettings::toneMapConfig(settingValue, toneMapConfig)) {
+        std::cerr << "Unknown tone mapping operator: \"" << settings.value("Output/tonemap").toString().toStdString() << "\"" << std::endl;
+        a.exit(1);
+        return 1;
+    }
+
+    // Any extra per-pixel channels to write out next to each frame
+    unsigned aovChannels = 0;
+    for (const QString &name : settings.value("AOV/channels").toStringList()) {
+        AOV::Channel channel;
+        if (name.trimmed().isEmpty()) {
+            continue;
+        }
+        if (!AOV::parseChannel(name.trimmed().toStdString(), channel)) {
+            std::cerr << "Unknown AOV channel: \"" << name.toStdString() << "\"" << std::endl;
+            a.exit(1);
+            return 1;
+        }
+        aovChannels |= channel;
+    }
+
+    // Cost heatmaps: false-color images of what each pixel cost to trace. Their channels are written raw like the AOVs.
+    unsigned heatmapChannels = 0;
+    for (const QString &name : settings.value("Heatmap/channels").toStringList()) {
+        AOV::Channel channel;
+        if (name.trimmed().isEmpty()) {
+            continue;
+        }
+        if (!AOV::parseChannel(name.trimmed().toStdString(), channel) || !(channel & AOV::COST_CHANNELS)) {
+            std::cerr << "Unknown heatmap channel: \"" << name.toStdString() << "\"; use time, intersections, shadow-rays or recursion" << std::endl;
+            a.exit(1);
+            return 1;
+        }
+        heatmapChannels |= channel;
+    }
+    if ((heatmapChannels & (AOV::INTERSECTIONS | AOV::SHADOW_RAYS)) && !Stats::ENABLED) {
+        std::cerr << "Warning: stats were compiled out (SKIPPY_ENABLE_STATS=OFF), so the intersections and shadow-rays heatmaps will be empty" << std::endl;
+    }
+    aovChannels |= heatmapChannels;
+    const float heatmapPercentile = std::clamp(settings.value("Heatmap/percentile", 99).toFloat(), 0.f, 100.f);
+    const int heatmapObjects = settings.value("Heatmap/objects", 5).toInt();
+
+    int pngQuality = RenderSettings::pngQuality(settingValue);
+
+    // Rendering in bands streams each frame to disk as it goes, so the whole frame is never in memory at once
+    int bandHeight = settings.value("Output/band-height", 0).toInt();
+    ScanlineWriter::Format bandFormat = ScanlineWriter::Format::PPM;
+    if (bandHeight > 0 && !ScanlineWriter::parseFormat(oFormat.toStdString(), bandFormat)) {
+        std::cerr << "Output format \"" << oFormat.toStdString() << "\" can't be written in bands; use ppm, raw, qoi, pfm or exr" << std::endl;
+        a.exit(1);
+        return 1;
+    }
+    if (bandHeight > 0 && aovChannels != 0) {
+        std::cerr << "AOVs can't be written when rendering in bands" << std::endl;
+        a.exit(1);
+        return 1;
+    }
+
+    // Frames whose render inputs are identical to the last rendered frame's are emitted again instead of traced
+    QString duplicateMode = settings.value("Output/duplicates", "resend").toString();
+    if (duplicateMode != "off" && duplicateMode != "resend" && duplicateMode != "copy" && duplicateMode != "link") {
+        std::cerr << "Unknown duplicate frame mode: \"" << duplicateMode.toStdString() << "\"" << std::endl;
+        a.exit(1);
+        return 1;
+    }
 
     // Create a directory for the frames to go in
     QDir().mkdir(oImagePath);
 
-    auto renderFrame = [&](int frame) {
-        std::cout << "Rendering frame " << frame << std::endl;
+    // Optionally stream frames straight into a video instead of (or as well as) saving each one as an image
+    QString streamMode = settings.value("Stream/mode", "none").toString();
+    if (streamMode != "none" && streamMode != "y4m" && streamMode != "ffmpeg" && streamMode != "gif") {
+        std::cerr << "Unknown stream mode: \"" << streamMode.toStdString() << "\"" << std::endl;
+        a.exit(1);
+        return 1;
+    }
+    if (bandHeight > 0 && streamMode != "none") {
+        std::cerr << "Frames can't be streamed when rendering in bands" << std::endl;
+        a.exit(1);
+        return 1;
+    }
+    bool keepFrames = streamMode == "none" || settings.value("Stream/keep-frames", false).toBool();
 
-        // Extracting data pointer from Qt's image API
-        QImage image = QImage(width, height, QImage::Format_RGBX8888);
-        image.fill(Qt::black);
-        RGBA *data = reinterpret_cast<RGBA *>(image.bits());
+    std::unique_ptr<VideoStream> stream;
+    std::unique_ptr<GifWriter> gif;
+    if (streamMode == "gif") {
+        GifWriter::Config gifConfig{};
+        gifConfig.globalPalette = settings.value("GIF/palette", "frame").toString() == "global";
+        gifConfig.dither        = settings.value("GIF/dither", gifConfig.dither).toBool();
+        gifConfig.deltaFrames   = settings.value("GIF/delta", gifConfig.deltaFrames).toBool();
+        gifConfig.loops         = settings.value("GIF/loops", gifConfig.loops).toInt();
 
-        RayTracer raytracer{ rtConfig };
-        RayTraceScene rtScene{ width, height, *metaData[frame] };
+        QString gifPath = settings.value("Stream/path").toString();
+        if (gifPath.isEmpty()) {
+            gifPath = oImagePath + "/animation.gif";
+        }
+
+        gif = GifWriter::open(gifPath.toStdString(), width, height, scene->framerate(), gifConfig);
+        if (!gif) {
+            std::cerr << "Error: failed to open \"" << gifPath.toStdString() << "\"" << std::endl;
+            a.exit(1);
+            return 1;
+        }
+    } else if (streamMode != "none") {
+        VideoStream::Chroma chroma = settings.value("Stream/chroma", "420").toString() == "444"
+                ? VideoStream::Chroma::C444 : VideoStream::Chroma::C420;
+        int framerate = scene->framerate();
+
+        if (streamMode == "y4m") {
+            QString streamPath = settings.value("Stream/path").toString();
+            if (streamPath.isEmpty()) {
+                streamPath = oImagePath + "/video.y4m";
+            }
+            stream = VideoStream::openFile(streamPath.toStdString(), width, height, framerate, chroma);
+        } else {
+            QString encoderArgs = settings.value("Stream/encoder-args", "-c:v libx264 -crf 10 -pix_fmt yuv420p").toString();
+            QString command = "ffmpeg -loglevel error -y -f yuv4mpegpipe -i - " + encoderArgs + " \"" + oImagePath + "/video.mp4\"";
+            stream = VideoStream::openEncoder(command.toStdString(), width, height, framerate, chroma);
+        }
 
-        // Note that we're passing `data` as a pointer (to its first element)
-        // Recall from Lab 1 that you can access its elements like this: `data[i]`
-        raytracer.render(data, rtScene);
+        if (!stream) {
+            std::cerr << "Error: failed to open the " << streamMode.toStdString() << " video stream" << std::endl;
+            a.exit(1);
+            return 1;
+        }
+    }
+
+    // Finished frames are kept between runs, so re-rendering after a small change only renders the frames it touched
+    std::unique_ptr<FrameCache> cache;
+    if (settings.value("Cache/enabled", false).toBool()) {
+        QString cachePath = settings.value("Cache/path").toString();
+        if (cachePath.isEmpty()) {
+            cachePath = oImagePath + "/.frame-cache";
+        }
+        std::uintmax_t maxBytes = std::uintmax_t(settings.value("Cache/max-size-mb", 2048).toLongLong()) << 20;
+
+        if (streamMode != "none" || aovChannels != 0) {
+            std::cerr << "The frame cache only holds frame files, so it can't be used with streaming or AOVs" << std::endl;
+        } else if (!(cache = FrameCache::open(cachePath.toStdString(), maxBytes))) {
+            std::cerr << "Error: failed to open the frame cache at \"" << cachePath.toStdString() << "\"" << std::endl;
+        }
+    }
+
+    // Ray and intersection counts and phase times for every rendered frame, to show why one frame is slower than another
+    std::unique_ptr<StatsWriter> statsWriter;
+    const QString statsPath = settings.value("Stats/path").toString();
+    const QString prometheusPath = settings.value("Stats/prometheus").toString();
+    if (!statsPath.isEmpty() || !prometheusPath.isEmpty()) {
+        if (!Stats::ENABLED) {
+            std::cerr << "This build was made with SKIPPY_ENABLE_STATS off, so no stats will be written" << std::endl;
+        } else if (!(statsWriter = StatsWriter::open(statsPath.toStdString(), prometheusPath.toStdString()))) {
+            std::cerr << "Error: failed to open the stats file \"" << statsPath.toStdString() << "\"" << std::endl;
+        }
+    }
+
+    // A frame's key identifies its output across runs: its scene hash, plus the renderer version, the output settings
+    // and the files it reads
+    SceneHash::Hasher outputHasher;
+    outputHasher.add(SceneHash::RENDERER_VERSION);
+    outputHasher.add(oFormat.toStdString());
+    outputHasher.add(int(toneMapConfig.op));
+    outputHasher.add(toneMapConfig.exposure);
+    outputHasher.add(toneMapConfig.srgb);
+    outputHasher.add(pngQuality);
+    const SceneHash::Hash outputHash = outputHasher.value();
+
+    auto frameKeyFor = [&](int frame, SceneHash::Hash sceneHash) {
+        SceneHash::Hasher hasher;
+        hasher.add(&outputHash, sizeof(outputHash));
+        hasher.add(&sceneHash, sizeof(sceneHash));
+        SceneHash::addFileStamps(hasher, scene->frame(frame));
+        return hasher.value();
+    };
 
-        // Save frame as its own PNG image with a frame number in the file name
-        QString number = QStringLiteral("%1").arg(frame, 5, 10, QLatin1Char('0'));
-        QString framePath = oImagePath + "/frame" + number + ".png";
-        bool success = image.save(framePath, "PNG");
+    // Finished frames are recorded as they're written, so an interrupted render can be picked up with --resume. Each
+    // shard keeps its own manifest, since shards sharing an output directory may run at the same time. Workers get
+    // different frames from run to run, so they don't keep one.
+    std::unique_ptr<RenderManifest> manifest;
+    if (isWorker && resume) {
+        std::cerr << "Workers can't resume; the coordinator decides which frames they render" << std::endl;
+    } else if (streamMode == "none" && !isWorker) {
+        QString manifestPath = oImagePath + (parser.isSet(shardOption)
+                ? QStringLiteral("/manifest.shard%1of%2.txt").arg(shardIndex).arg(shardCount)
+                : QStringLiteral("/manifest.txt"));
+        manifest = RenderManifest::open(manifestPath.toStdString(), resume);
+        if (!manifest) {
+            std::cerr << "Error: failed to write the manifest \"" << manifestPath.toStdString() << "\"" << std::endl;
+        } else if (resume) {
+            std::cout << "Resuming a render with " << manifest->size() << " frame(s) already finished" << std::endl;
+        }
+    } else if (resume) {
+        std::cerr << "Streamed renders can't be resumed, since the stream needs every frame" << std::endl;
+        a.exit(1);
+        return 1;
+    }
+
+    // Encoder threads can finish frames out of order, but the stream has to receive them in order
+    ReorderBuffer<std::function<bool()>> streamQueue(frames, [&](int frame, std::function<bool()> &&write) {
+        if (!write()) {
+            std::cerr << "Error: failed to stream frame " << frame << std::endl;
+        }
+    });
+
+    // The frame number as it appears in output file names
+    auto frameNumber = [](int frame) {
+        return QStringLiteral("%1").arg(frame, 5, 10, QLatin1Char('0'));
+    };
+
+    auto framePathFor = [&](int frame) {
+        return oImagePath + "/frame" + frameNumber(frame) + "." + oFormat;
+    };
+
+    auto checkpointPathFor = [&](int frame) {
+        return (oImagePath + "/frame" + frameNumber(frame) + ".checkpoint").toStdString();
+    };
+
+    // Records a frame whose files are all on disk, so a resumed render won't render it again
+    auto finishFrame = [&](int frame, std::uint64_t frameKey) {
+        if (manifest && !manifest->add(frame, frameKey, ("frame" + frameNumber(frame) + "." + oFormat).toStdString())) {
+            std::cerr << "Error: failed to record frame " << frame << " in the manifest" << std::endl;
+        }
+    };
+
+    // Converts a rendered frame to its output format and writes it (and its AOVs) to disk
+    auto saveFrame = [&](int frame, const FrameBuffer &frameBuffer, const AOV::Buffers *aovs) {
+        // Save each requested AOV channel as a float map next to the frame
+        for (AOV::Channel channel : AOV::ALL_CHANNELS) {
+            if (!(aovChannels & channel)) {
+                continue;
+            }
+
+            QString aovPath = oImagePath + "/frame" + frameNumber(frame) + "." + QString::fromStdString(AOV::channelName(channel)) + ".pfm";
+            bool saved = AtomicFile::write(aovPath.toStdString(), [&](const std::string &partial) {
+                return ImageWriter::writePFM(partial, aovs->data(channel), width, height, aovs->components(channel));
+            });
+            if (!saved) {
+                std::cerr << "Error: failed to save AOV to \"" << aovPath.toStdString() << "\"" << std::endl;
+            }
+        }
+
+        // Draw each cost channel as a heatmap, scaled to that channel's own values in this frame
+        for (AOV::Channel channel : AOV::ALL_CHANNELS) {
+            if (!(heatmapChannels & channel)) {
+                continue;
+            }
+
+            const float *values = aovs->data(channel);
+            std::vector<RGBA> heat(frameBuffer.size());
+            Heatmap::colorize(values, int(heat.size()), Heatmap::scale(values, int(heat.size()), heatmapPercentile), heat.data());
+
+            QString heatPath = oImagePath + "/frame" + frameNumber(frame) + "." + QString::fromStdString(AOV::channelName(channel)) + ".heat.png";
+            bool saved = AtomicFile::write(heatPath.toStdString(), [&](const std::string &partial) {
+                return FrameWriter::writeBytes(partial, "png", heat.data(), width, height, pngQuality);
+            });
+            if (!saved) {
+                std::cerr << "Error: failed to save heatmap to \"" << heatPath.toStdString() << "\"" << std::endl;
+            }
+        }
+
+        // Frames are written under a temporary name and renamed into place, so a crash never leaves half a frame
+        const std::string framePath = framePathFor(frame).toStdString();
+
+        // Floating-point formats skip tone mapping, unless a stream needs the 8-bit frame too
+        auto writeFloatFrame = [&]() {
+            return AtomicFile::write(framePath, [&](const std::string &partial) {
+                return FrameWriter::writeFloat(partial, oFormat.toStdString(), frameBuffer);
+            });
+        };
+
+        if (floatFormat && !stream && !gif) {
+            return writeFloatFrame();
+        }
+
+        std::vector<RGBA> pixels(frameBuffer.size());
+        RGBA *data = pixels.data();
+
+        // Encoder threads run alongside the tracer, so leave the thread pool to it
+        ToneMap::apply(frameBuffer, data, toneMapConfig, false);
+
+        if (stream) {
+            // The colorspace conversion runs here on the encoder threads; only the write itself is serialized
+            auto bytes = std::make_shared<std::vector<std::uint8_t>>(stream->convert(data));
+            streamQueue.push(frame, [&stream, bytes]() { return stream->write(*bytes); });
+        } else if (gif) {
+            // Each GIF frame is encoded against the one before it, so the whole encode happens in order
+            auto gifPixels = std::make_shared<std::vector<RGBA>>(pixels);
+            streamQueue.push(frame, [&gif, gifPixels]() { return gif->addFrame(gifPixels->data()); });
+        }
+
+        if (!keepFrames) {
+            return true;
+        }
+
+        if (floatFormat) {
+            return writeFloatFrame();
+        }
+
+        return AtomicFile::write(framePath, [&](const std::string &partial) {
+            return FrameWriter::writeBytes(partial, oFormat.toStdString(), data, width, height, pngQuality);
+        });
+    };
+
+    // Compressing and writing frames happens on separate threads, so the tracer never waits on the encoder or the disk
+    EncoderPipeline encoder(
+        settings.value("Output/encoder-threads", 2).toInt(),
+        settings.value("Output/queue-size", 4).toInt(),
+        [&](int frame, bool success) {
+            QString framePath = framePathFor(frame);
+            if (success && !keepFrames) {
+                std::cout << "Streamed frame " << frame << std::endl;
+            } else if (success) {
+                std::cout << "Saved rendered image to \"" << framePath.toStdString() << "\"" << std::endl;
+            } else {
+                std::cerr << "Error: failed to save image to \"" << framePath.toStdString() << "\"" << std::endl;
+            }
+        });
+
+    // Banded frames are written without going through the encoder, so their failures are counted here instead
+    int bandFailures = 0;
+
+    // Renders a frame a band at a time, writing each band out before the next is rendered
+    auto renderFrameInBands = [&](int frame, RayTracer &raytracer, const RayTraceScene &rtScene) {
+        QString framePath = framePathFor(frame);
+
+        bool success = AtomicFile::write(framePath.toStdString(), [&](const std::string &partial) {
+            std::unique_ptr<ScanlineWriter> writer = ScanlineWriter::open(partial, width, height, bandFormat);
+            std::vector<RGBA> bandPixels;
+
+            bool written = writer && raytracer.renderBands(rtScene, bandHeight, [&](const FrameBuffer &band, int) {
+                if (ScanlineWriter::isFloat(bandFormat)) {
+                    return writer->writeRows(band.data(), band.height);
+                }
+
+                bandPixels.resize(band.size());
+                ToneMap::apply(band, bandPixels.data(), toneMapConfig, rtConfig.enableParallelism);
+                return writer->writeRows(bandPixels.data(), band.height);
+            });
+            return writer && writer->close() && written;
+        });
 
         if (success) {
             std::cout << "Saved rendered image to \"" << framePath.toStdString() << "\"" << std::endl;
         } else {
             std::cerr << "Error: failed to save image to \"" << framePath.toStdString() << "\"" << std::endl;
+            bandFailures++;
         }
+        return success;
+    };
 
-        return;
+    // The last frame that was actually rendered, which identical frames after it are emitted from
+    struct RenderedFrame {
+        int frame;
+        SceneHash::Hash hash;
+        std::shared_ptr<FrameBuffer> frameBuffer; // Null if the frame was rendered in bands
+        std::shared_ptr<AOV::Buffers> aovs;
+        std::shared_future<bool> saved;           // Ready once the frame's file has been written
+    };
+    std::optional<RenderedFrame> lastRendered;
+
+    // Copying or linking a frame's file only covers frames that are a single file on disk
+    const bool reuseFiles = (duplicateMode == "copy" || duplicateMode == "link") && !stream && !gif && aovChannels == 0;
+
+    // Makes a frame's file a copy (or a hard link, where the filesystem allows it) of an earlier frame's
+    auto reuseFrameFile = [&](int source, int frame) {
+        const std::filesystem::path sourcePath = framePathFor(source).toStdString();
+
+        return AtomicFile::write(framePathFor(frame).toStdString(), [&](const std::string &partial) {
+            std::error_code error;
+            std::filesystem::remove(partial, error);
+            if (duplicateMode == "link") {
+                std::filesystem::create_hard_link(sourcePath, partial, error);
+                if (!error) {
+                    return true;
+                }
+            }
+            return std::filesystem::copy_file(sourcePath, partial, std::filesystem::copy_options::overwrite_existing, error);
+        });
+    };
+
+    // Notes a frame whose file is already on disk as the last rendered one
+    auto frameOnDisk = [&](int frame, SceneHash::Hash hash, bool success) {
+        std::promise<bool> saved;
+        saved.set_value(success);
+        lastRendered = RenderedFrame{ frame, hash, nullptr, nullptr, saved.get_future().share() };
+    };
+
+    // Emits a frame that is identical to the last rendered one without rendering it
+    auto emitDuplicate = [&](int frame, std::uint64_t frameKey) {
+        const RenderedFrame source = lastRendered.value();
+
+        // hand the encoder the same buffer again, which also keeps streams and GIFs fed
+        if (!reuseFiles && source.frameBuffer) {
+            encoder.submit(frame, [frame, frameKey, source, &saveFrame, &finishFrame]() {
+                bool success = saveFrame(frame, *source.frameBuffer, source.aovs.get());
+                if (success) {
+                    finishFrame(frame, frameKey);
+                }
+                return success;
+            });
+            return;
+        }
+
+        // the source was submitted first, so an encoder thread is already writing it by the time this waits on it
+        encoder.submit(frame, [frame, frameKey, source, &reuseFrameFile, &finishFrame]() {
+            bool success = source.saved.get() && reuseFrameFile(source.frame, frame);
+            if (success) {
+                finishFrame(frame, frameKey);
+            }
+            return success;
+        });
+    };
+
+    // Consecutive frames that share a camera and lights only re-trace the pixels around whatever moved, and frames
+    // that share a camera and geometry only re-shade the hits kept from the frame before
+    std::optional<IncrementalRenderer> incremental;
+    IncrementalRenderer::Mode incrementalMode;
+    incrementalMode.dirtyRegions = settings.value("Feature/incremental", false).toBool();
+    incrementalMode.gbuffer = settings.value("Feature/gbuffer-cache", false).toBool();
+    if (incrementalMode.dirtyRegions || incrementalMode.gbuffer) {
+        if (!IncrementalRenderer::supports(rtConfig) || aovChannels != 0 || bandHeight > 0) {
+            std::cerr << "Incremental rendering can't be combined with denoising, AOVs or banded output; rendering every frame in full" << std::endl;
+        } else {
+            incremental.emplace(rtConfig, incrementalMode);
+        }
+    }
+
+    // Slow frames can save their finished rows every so often, so an interrupted frame carries on from them
+    int checkpointSeconds = settings.value("Output/checkpoint-seconds", 0).toInt();
+    if (checkpointSeconds > 0 && (rtConfig.enableDenoise || aovChannels != 0 || bandHeight > 0 || incremental)) {
+        std::cerr << "Checkpoints can't be combined with denoising, AOVs, banded output or incremental rendering; frames won't be checkpointed" << std::endl;
+        checkpointSeconds = 0;
+    }
+    const int checkpointRows = 16;
+
+    // Renders a frame a few rows at a time, starting from its checkpoint when resuming, and saving a new checkpoint
+    // whenever the last one is more than checkpointSeconds old
+    auto renderWithCheckpoints = [&](int frame, std::uint64_t frameKey, RayTracer &raytracer, const RayTraceScene &rtScene,
+                                     FrameBuffer &frameBuffer) {
+        const std::string checkpointPath = checkpointPathFor(frame);
+
+        int row = resume ? Checkpoint::load(checkpointPath, frameKey, frameBuffer) : 0;
+        if (row > 0) {
+            std::cout << "Resuming frame " << frame << " from row " << row << std::endl;
+        }
+
+        auto lastSaved = std::chrono::steady_clock::now();
+        while (row < height) {
+            const int rowEnd = std::min(row + checkpointRows, height);
+            raytracer.renderRegion(frameBuffer, rtScene, DirtyRegion::Rect{ 0, row, width, rowEnd });
+            row = rowEnd;
+
+            if (row < height && std::chrono::steady_clock::now() - lastSaved >= std::chrono::seconds(checkpointSeconds)) {
+                if (!Checkpoint::save(checkpointPath, frameKey, frameBuffer, row)) {
+                    std::cerr << "Error: failed to checkpoint frame " << frame << std::endl;
+                }
+                lastSaved = std::chrono::steady_clock::now();
+            }
+        }
+
+        raytracer.postProcess(frameBuffer, nullptr);
+    };
+
+    auto renderFrame = [&](int frame) {
+        // interpolants hold their last keyframe, so animations often end with a run of identical frames
+        SceneHash::Hash hash = SceneHash::of(scene->frame(frame), width, height, rtConfig);
+        const std::uint64_t frameKey = frameKeyFor(frame, hash);
+
+        // a resumed render skips whatever the interrupted one finished, as long as its inputs haven't changed since
+        if (resume && manifest && manifest->isFinished(frame, frameKey) && QFile::exists(framePathFor(frame))) {
+            std::cout << "Frame " << frame << " was already finished" << std::endl;
+            frameOnDisk(frame, hash, true);
+            return;
+        }
+
+        if (duplicateMode != "off" && lastRendered && lastRendered->hash == hash) {
+            std::cout << "Frame " << frame << " is identical to frame " << lastRendered->frame << "; reusing it" << std::endl;
+            emitDuplicate(frame, frameKey);
+            return;
+        }
+
+        if (cache && cache->restore(frameKey, oFormat.toStdString(), framePathFor(frame).toStdString())) {
+            std::cout << "Restored frame " << frame << " from the cache" << std::endl;
+            finishFrame(frame, frameKey);
+
+            // later duplicates of this frame can copy the restored file
+            frameOnDisk(frame, hash, true);
+            return;
+        }
+
+        std::cout << "Rendering frame " << frame << std::endl;
+        Trace::setFrame(frame);
+        Trace::Span frameSpan("render frame");
+
+        // anything counted before now belongs to some other frame
+        if (statsWriter) {
+            Stats::collect();
+        }
+
+        RayTracer raytracer{ rtConfig };
+        RayTraceScene rtScene{ width, height, scene->frame(frame) };
+        if (!rtScene.getFailedTextures().empty()) {
+            std::cerr << "Critical ERROR: failed to load the textures of frame " << frame << std::endl;
+            std::exit(1);
+        }
+
+        if (bandHeight > 0) {
+            bool success = renderFrameInBands(frame, raytracer, rtScene);
+
+            // the bands are written as they're traced, so the encode time is part of the trace time
+            if (statsWriter) {
+                statsWriter->write(frame, Stats::collect());
+            }
+            if (success) {
+                if (cache) {
+                    cache->store(frameKey, oFormat.toStdString(), framePathFor(frame).toStdString());
+                }
+                finishFrame(frame, frameKey);
+            }
+
+            frameOnDisk(frame, hash, success);
+            return;
+        }
+
+        // Render into a floating-point frame; colors are only quantized once we know the output format
+        auto frameBuffer = std::make_shared<FrameBuffer>(width, height);
+        std::shared_ptr<AOV::Buffers> aovs;
+        if (aovChannels != 0) {
+            // the heatmap report puts each pixel's cost down to the object it shows
+            const unsigned reportChannels = heatmapChannels != 0 && heatmapObjects > 0 ? AOV::PRIMITIVE_ID : 0;
+            aovs = std::make_shared<AOV::Buffers>(width, height, aovChannels | reportChannels);
+        }
+        if (incremental) {
+            IncrementalRenderer::Result result = incremental->render(*frameBuffer, rtScene, scene->frame(frame));
+            if (result.relit) {
+                std::cout << "Relit frame " << frame << " from the previous frame's hits" << std::endl;
+            } else {
+                std::cout << "Traced " << int(std::round(100 * result.traced)) << "% of frame " << frame << std::endl;
+            }
+        } else if (checkpointSeconds > 0) {
+            renderWithCheckpoints(frame, frameKey, raytracer, rtScene, *frameBuffer);
+        } else {
+            raytracer.render(*frameBuffer, rtScene, aovs.get());
+        }
+
+        if (heatmapChannels != 0) {
+            const RenderData &data = scene->frame(frame);
+            const std::vector<int> &shapeIndices = rtScene.getShapeIndices();
+            auto describe = [&](int primitive) {
+                // in the order of PrimitiveType
+                static const char *TYPE_NAMES[] = { "cube", "cone", "cylinder", "torus", "sphere", "mesh" };
+                const int shape = shapeIndices[primitive];
+                const ScenePrimitive &object = data.shapes[shape].primitive;
+                std::string name = "shape " + std::to_string(shape) + " (" + TYPE_NAMES[int(object.type)];
+                if (rtConfig.enableReflection && glm::any(glm::notEqual(object.material.cReflective, glm::vec4(0.f)))) {
+                    name += ", reflective";
+                }
+                return name + ")";
+            };
+            std::cout << "Cost of frame " << frame << ":" << std::endl
+                      << Heatmap::report(*aovs, heatmapChannels, heatmapPercentile, heatmapObjects, describe) << std::flush;
+        }
+
+        const Stats::Frame frameStats = statsWriter ? Stats::collect() : Stats::Frame{};
+
+        // Hand the frame off to the encoder and move straight on to the next one
+        auto saved = std::make_shared<std::promise<bool>>();
+        lastRendered = RenderedFrame{ frame, hash, frameBuffer, aovs, saved->get_future().share() };
+        Trace::Span queueSpan("queue frame");
+        encoder.submit(frame, [&, frame, frameKey, frameBuffer, aovs, saved, frameStats]() {
+            if (Trace::enabled()) {
+                Trace::nameThread("encoder");
+            }
+            const auto encodeStart = std::chrono::steady_clock::now();
+            bool success = saveFrame(frame, *frameBuffer, aovs.get());
+            Trace::record("save frame", encodeStart, std::chrono::steady_clock::now(), frame);
+            if (statsWriter) {
+                Stats::Frame stats = frameStats;
+                stats.seconds[Stats::ENCODE] = std::chrono::duration<double>(std::chrono::steady_clock::now() - encodeStart).count();
+                statsWriter->write(frame, stats);
+            }
+            if (success) {
+                if (cache) {
+                    cache->store(frameKey, oFormat.toStdString(), framePathFor(frame).toStdString());
+                }
+                finishFrame(frame, frameKey);
+
+                // the frame is safely on disk, so its checkpoint is no longer needed
+                std::error_code error;
+                std::filesystem::remove(checkpointPathFor(frame), error);
+            }
+            saved->set_value(success);
+            return success;
+        });
     };
 
 
@@ -106,11 +835,53 @@ int main(int argc, char *argv[])
 //        QtConcurrent::blockingMap(frameNums, renderFrame);
 //    } else {
         // otherwise just use on single thread.
-    for (int i = 0; i < metaData[0]->globalData.numFrames; i++) {
-        renderFrame(i);
+    if (isWorker) {
+        // render chunks until the coordinator runs out, reporting each one once all of its frames are on disk
+        WorkerClient client;
+        if (!client.connectTo(parser.value(workerOption))) {
+            std::cerr << "Error: failed to connect to the coordinator on \"" << parser.value(workerOption).toStdString() << "\"" << std::endl;
+            a.exit(1);
+            return 1;
+        }
+
+        while (std::optional<FarmProtocol::Chunk> chunk = client.nextChunk()) {
+            const int failuresBefore = encoder.wait() + bandFailures;
+            for (int frame : chunk->frames) {
+                renderFrame(frame);
+            }
+            client.report(chunk->id, encoder.wait() + bandFailures == failuresBefore);
+        }
+    } else {
+        for (int frame : frames) {
+            renderFrame(frame);
+        }
     }
 //    }
 
-    a.exit();
-    return 0;
+    // Wait for the last frames to be written before exiting
+    int failures = encoder.finish() + bandFailures;
+    if (failures > 0) {
+        std::cerr << failures << " frame(s) failed to save" << std::endl;
+    }
+
+    // Every frame has been pushed by now, so ending the stream lets the encoder finish the video
+    if (stream && !stream->close()) {
+        std::cerr << "Error: the video stream did not finish cleanly" << std::endl;
+    }
+    if (gif && !gif->close()) {
+        std::cerr << "Error: the GIF did not finish cleanly" << std::endl;
+    }
+
+    if (parser.isSet(traceOption)) {
+        if (Trace::finish()) {
+            std::cout << "Wrote the timeline to \"" << parser.value(traceOption).toStdString() << "\"" << std::endl;
+        } else {
+            std::cerr << "Error: failed to write the timeline \"" << parser.value(traceOption).toStdString() << "\"" << std::endl;
+        }
+    }
+
+    // exit with an error if any frame is missing, so a script or the farm can tell
+    const int status = failures > 0 ? 1 : 0;
+    a.exit(status);
+    return status;
 }
@@ -0,0 +1,42 @@
+#include "atomicfile.h"
+
+#include <filesystem>
+
+namespace AtomicFile {
+    std::string partialPath(const std::string &path) {
+        return path + ".partial";
+    }
+
+    /**
+     * @brief write - writes a file under a temporary name and renames it into place
+     * @param path - where the finished file belongs
+     * @param write - writes the file to the path it's given
+     * @return whether the file was written and is now at path
+     */
+    bool write(const std::string &path, const std::function<bool(const std::string &partial)> &write) {
+        const std::string partial = partialPath(path);
+        if (!write(partial)) {
+            std::error_code error;
+            std::filesystem::remove(partial, error);
+            return false;
+        }
+        return commit(partial, path);
+    }
+
+    /**
+     * @brief commit - renames a temporary file into place. A rename within a directory replaces the destination in
+     * one step, so readers see either the old file or the new one.
+     * @param partial - the finished temporary file
+     * @param path - where it belongs
+     * @return whether the rename succeeded
+     */
+    bool commit(const std::string &partial, const std::string &path) {
+        std::error_code error;
+        std::filesystem::rename(partial, path, error);
+        if (error) {
+            std::filesystem::remove(partial, error);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+// Writes files under a temporary name and renames them into place once they're complete, so a crash never leaves a
+// half-written file where a finished one is expected.
+namespace AtomicFile {
+    // The temporary name a file is written under
+    std::string partialPath(const std::string &path);
+
+    // Calls write with the temporary path, then renames the result to path if it succeeded (or deletes it if not)
+    bool write(const std::string &path, const std::function<bool(const std::string &partial)> &write);
+
+    // Renames a finished temporary file into place, replacing anything already there
+    bool commit(const std::string &partial, const std::string &path);
+}
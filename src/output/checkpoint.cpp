@@ -0,0 +1,69 @@
+#include "checkpoint.h"
+#include "atomicfile.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace Checkpoint {
+    static const char MAGIC[8] = { 'S', 'K', 'P', 'C', 'K', 'P', 'T', '1' };
+
+    // Everything before the pixels, which are stored as raw RGBA floats
+    struct Header {
+        char magic[8];
+        std::uint64_t key;
+        std::int32_t width;
+        std::int32_t height;
+        std::int32_t rows;
+    };
+
+    /**
+     * @brief save - writes the finished rows of a frame to a checkpoint file
+     * @param path - the checkpoint file
+     * @param key - identifies the frame's inputs
+     * @param frame - the partly rendered frame
+     * @param rows - how many rows from the top are finished
+     * @return whether the checkpoint was written
+     */
+    bool save(const std::string &path, std::uint64_t key, const FrameBuffer &frame, int rows) {
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.key = key;
+        header.width = frame.width;
+        header.height = frame.height;
+        header.rows = rows;
+
+        return AtomicFile::write(path, [&](const std::string &partial) {
+            std::ofstream file(partial, std::ios::binary);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(frame.data()), std::streamsize(sizeof(glm::vec4)) * frame.width * rows);
+            return file.good();
+        });
+    }
+
+    /**
+     * @brief load - reads the finished rows of a checkpoint back into a frame
+     * @param path - the checkpoint file
+     * @param key - identifies the frame's inputs, which must match the checkpoint's
+     * @param frame - the frame to fill, which must be the size the checkpoint was saved at
+     * @return the number of rows filled in
+     */
+    int load(const std::string &path, std::uint64_t key, FrameBuffer &frame) {
+        std::ifstream file(path, std::ios::binary);
+        Header header{};
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+            return 0;
+        }
+
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.key != key || header.width != frame.width
+                || header.height != frame.height || header.rows <= 0 || header.rows > frame.height) {
+            return 0;
+        }
+
+        // checkpoints are renamed into place whole, so a short read means the file was damaged some other way
+        if (!file.read(reinterpret_cast<char *>(frame.data()), std::streamsize(sizeof(glm::vec4)) * frame.width * header.rows)) {
+            return 0;
+        }
+
+        return header.rows;
+    }
+}
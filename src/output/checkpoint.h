@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "utils/framebuffer.h"
+
+// Snapshots of a frame that is still being rendered, so a slow frame that is interrupted can carry on from the rows it
+// had finished instead of starting over. Each snapshot is tagged with the key of the frame's inputs, and is only
+// loaded back into a frame with the same key and size.
+namespace Checkpoint {
+    // Saves the first `rows` rows of a partly rendered frame, replacing any earlier checkpoint in one step
+    bool save(const std::string &path, std::uint64_t key, const FrameBuffer &frame, int rows);
+
+    // Loads the finished rows of a checkpoint into the top of frame
+    // @return The number of rows loaded, which is 0 if there is no checkpoint or it belongs to different inputs.
+    int load(const std::string &path, std::uint64_t key, FrameBuffer &frame);
+}
@@ -0,0 +1,113 @@
+#include "encoderpipeline.h"
+
+#include <algorithm>
+
+EncoderPipeline::EncoderPipeline(int threads, int capacity, Reporter reporter) :
+    m_capacity(std::max(capacity, 1)),
+    m_reporter(reporter)
+{
+    for (int i = 0; i < std::max(threads, 1); i++) {
+        m_threads.emplace_back(&EncoderPipeline::work, this);
+    }
+}
+
+EncoderPipeline::~EncoderPipeline() {
+    finish();
+}
+
+/**
+ * @brief EncoderPipeline::submit - queue a frame to be encoded by the next free encoder thread
+ * @param frame - the frame number, passed back to the reporter
+ * @param job - encodes and writes the frame
+ */
+void EncoderPipeline::submit(int frame, Job job) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_hasRoom.wait(lock, [&] { return m_queue.size() < m_capacity; });
+
+    m_queue.emplace_back(m_nextSequence++, frame, std::move(job));
+    m_hasWork.notify_one();
+}
+
+/**
+ * @brief EncoderPipeline::wait - block until every frame submitted so far has been written and reported
+ * @return the number of frames that have failed to write so far
+ */
+int EncoderPipeline::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_allReported.wait(lock, [&] { return m_nextToReport == m_nextSequence; });
+    return m_failures;
+}
+
+/**
+ * @brief EncoderPipeline::finish - drain the queue and join the encoder threads. Safe to call more than once.
+ * @return the number of frames that failed to write
+ */
+int EncoderPipeline::finish() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_hasWork.notify_all();
+
+    for (std::thread &thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+
+    return m_failures;
+}
+
+/**
+ * @brief EncoderPipeline::work - the loop each encoder thread runs, taking frames off the queue until it is
+ * empty and the pipeline is stopping
+ */
+void EncoderPipeline::work() {
+    while (true) {
+        std::tuple<long, int, Job> item;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_hasWork.wait(lock, [&] { return !m_queue.empty() || m_stopping; });
+
+            if (m_queue.empty()) {
+                return;
+            }
+
+            item = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_hasRoom.notify_one();
+
+        auto& [ sequence, frame, job ] = item;
+        bool success = job();
+        complete(sequence, frame, success);
+    }
+}
+
+/**
+ * @brief EncoderPipeline::complete - record a finished frame and report every frame that is now next in line
+ * @param sequence - the order the frame was submitted in
+ * @param frame - the frame number
+ * @param success - whether the frame was written
+ */
+void EncoderPipeline::complete(long sequence, int frame, bool success) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!success) {
+        m_failures++;
+    }
+    m_finishedOutOfOrder[sequence] = { frame, success };
+
+    // reporting under the lock keeps reports from different threads from interleaving
+    for (auto it = m_finishedOutOfOrder.begin(); it != m_finishedOutOfOrder.end() && it->first == m_nextToReport;
+         it = m_finishedOutOfOrder.erase(it)) {
+        auto& [ reportFrame, reportSuccess ] = it->second;
+        if (m_reporter) {
+            m_reporter(reportFrame, reportSuccess);
+        }
+        m_nextToReport++;
+    }
+
+    if (m_nextToReport == m_nextSequence) {
+        m_allReported.notify_all();
+    }
+}
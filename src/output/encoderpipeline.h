@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// A bounded queue of finished frames, drained by a pool of encoder threads. The render loop hands each frame off
+// with submit() and goes straight back to tracing; it only ever waits if it gets more than `capacity` frames ahead
+// of the encoders. Frames may finish encoding in any order, but completions are reported in submission order.
+class EncoderPipeline {
+public:
+    // Encodes and writes a single frame, returning whether it succeeded. Runs on an encoder thread.
+    using Job = std::function<bool()>;
+
+    // Called once per frame, in the order frames were submitted
+    using Reporter = std::function<void(int frame, bool success)>;
+
+    EncoderPipeline(int threads, int capacity, Reporter reporter);
+    ~EncoderPipeline();
+
+    EncoderPipeline(const EncoderPipeline &) = delete;
+    EncoderPipeline &operator=(const EncoderPipeline &) = delete;
+
+    // Queues a frame for encoding, blocking only while the queue is full
+    void submit(int frame, Job job);
+
+    // Waits for every frame submitted so far to be written and reported, leaving the encoder threads running.
+    // @return The number of frames that have failed to write so far.
+    int wait();
+
+    // Waits for every submitted frame to be written and stops the encoder threads.
+    // @return The number of frames that failed to write.
+    int finish();
+
+private:
+    void work();
+    void complete(long sequence, int frame, bool success);
+
+    const std::size_t m_capacity;
+    const Reporter m_reporter;
+
+    std::mutex m_mutex;
+    std::condition_variable m_hasWork;
+    std::condition_variable m_hasRoom;
+    std::condition_variable m_allReported;
+
+    std::deque<std::tuple<long, int, Job>> m_queue;
+    std::map<long, std::tuple<int, bool>> m_finishedOutOfOrder;
+    long m_nextSequence = 0;
+    long m_nextToReport = 0;
+    int m_failures = 0;
+    bool m_stopping = false;
+
+    std::vector<std::thread> m_threads;
+};
@@ -0,0 +1,200 @@
+#include "framecache.h"
+#include "atomicfile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Entries are written under this suffix first and renamed into place, so a half-written file is never restored
+static const std::string PARTIAL_SUFFIX = ".partial";
+
+// A partial this old was left by a run that died, rather than being written by another process sharing the cache
+static const std::chrono::hours PARTIAL_MAX_AGE{ 1 };
+
+FrameCache::FrameCache(const std::filesystem::path &directory, std::uintmax_t maxBytes) :
+    m_directory(directory),
+    m_maxBytes(maxBytes)
+{}
+
+/**
+ * @brief FrameCache::open - opens a cache directory, indexing the entries already in it. Files that aren't named like
+ * an entry are left alone, since the directory may be shared with other files.
+ * @param directory - where the cache lives
+ * @param maxBytes - the most the entries may add up to
+ * @return the cache, or null if the directory doesn't exist and can't be created
+ */
+std::unique_ptr<FrameCache> FrameCache::open(const std::string &directory, std::uintmax_t maxBytes) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (!std::filesystem::is_directory(directory, error)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<FrameCache> cache(new FrameCache(directory, maxBytes));
+
+    const std::filesystem::file_time_type staleBefore = std::filesystem::file_time_type::clock::now() - PARTIAL_MAX_AGE;
+    for (const std::filesystem::directory_entry &file : std::filesystem::directory_iterator(directory, error)) {
+        if (!file.is_regular_file(error)) {
+            continue;
+        }
+
+        // leftovers from a run that died while storing an entry, named <entry>.<random>.partial by store()
+        const std::string name = file.path().filename().string();
+        if (file.path().extension() == PARTIAL_SUFFIX) {
+            const std::string stored = file.path().stem().string();
+            const std::size_t dot = stored.rfind('.');
+            if (dot != std::string::npos && isEntryName(stored.substr(0, dot)) && file.last_write_time(error) < staleBefore) {
+                std::filesystem::remove(file.path(), error);
+            }
+            continue;
+        }
+        if (!isEntryName(name)) {
+            continue;
+        }
+
+        Entry entry{ file.file_size(error), file.last_write_time(error) };
+        cache->m_entries[name] = entry;
+        cache->m_totalBytes += entry.bytes;
+    }
+
+    std::lock_guard<std::mutex> lock(cache->m_mutex);
+    cache->evict();
+    return cache;
+}
+
+/**
+ * @brief FrameCache::restore - copies a cached frame out to where it belongs
+ * @param key - the hash of the frame's inputs
+ * @param extension - the file extension of the frame's format
+ * @param path - where to copy the frame to
+ * @return false if the frame isn't in the cache, or couldn't be copied
+ */
+bool FrameCache::restore(Key key, const std::string &extension, const std::string &path) {
+    const std::string name = entryName(key, extension);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_entries.contains(name)) {
+            return false;
+        }
+    }
+
+    // the copy only appears at path once it's complete
+    bool copied = AtomicFile::write(path, [&](const std::string &partial) {
+        std::error_code error;
+        return std::filesystem::copy_file(m_directory / name, partial, std::filesystem::copy_options::overwrite_existing, error);
+    });
+    if (!copied) {
+        return false;
+    }
+
+    std::error_code error;
+
+    // the modification time doubles as the last use, so it carries over to the next run
+    const std::filesystem::file_time_type now = std::filesystem::file_time_type::clock::now();
+    std::filesystem::last_write_time(m_directory / name, now, error);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_entries.find(name);
+    if (entry != m_entries.end()) {
+        entry->second.lastUsed = now;
+    }
+    return true;
+}
+
+/**
+ * @brief FrameCache::store - adds a copy of a finished frame to the cache
+ * @param key - the hash of the frame's inputs
+ * @param extension - the file extension of the frame's format
+ * @param path - the frame's file
+ * @return whether the frame is in the cache afterwards
+ */
+bool FrameCache::store(Key key, const std::string &extension, const std::string &path) {
+    const std::string name = entryName(key, extension);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_entries.contains(name)) {
+            return true;
+        }
+    }
+
+    // other threads (or processes sharing the cache) may be storing the same frame, so each copy gets its own name
+    thread_local std::mt19937_64 random{ std::random_device{}() };
+    char suffix[17];
+    std::snprintf(suffix, sizeof(suffix), "%016llx", static_cast<unsigned long long>(random()));
+    const std::filesystem::path partial = m_directory / (name + "." + suffix + PARTIAL_SUFFIX);
+
+    std::error_code error;
+    if (!std::filesystem::copy_file(path, partial, std::filesystem::copy_options::overwrite_existing, error)) {
+        std::filesystem::remove(partial, error);
+        return false;
+    }
+    const std::uintmax_t bytes = std::filesystem::file_size(partial, error);
+
+    std::filesystem::rename(partial, m_directory / name, error);
+    if (error) {
+        std::filesystem::remove(partial, error);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_entries.contains(name)) {
+        m_entries[name] = Entry{ bytes, std::filesystem::file_time_type::clock::now() };
+        m_totalBytes += bytes;
+        evict();
+    }
+    return true;
+}
+
+std::uintmax_t FrameCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_totalBytes;
+}
+
+std::string FrameCache::entryName(Key key, const std::string &extension) {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return std::string(name) + "." + extension;
+}
+
+/**
+ * @brief FrameCache::isEntryName - whether a file name has the form entryName gives: 16 hex digits and an extension
+ */
+bool FrameCache::isEntryName(const std::string &name) {
+    if (name.size() < 18 || name[16] != '.' || name.find('.', 17) != std::string::npos) {
+        return false;
+    }
+    return std::all_of(name.begin(), name.begin() + 16, [](char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+    });
+}
+
+/**
+ * @brief FrameCache::evict - deletes the least recently used entries until the cache fits in its limit. The caller
+ * must hold the lock.
+ */
+void FrameCache::evict() {
+    if (m_totalBytes <= m_maxBytes) {
+        return;
+    }
+
+    std::vector<std::map<std::string, Entry>::iterator> byAge;
+    for (auto entry = m_entries.begin(); entry != m_entries.end(); entry++) {
+        byAge.push_back(entry);
+    }
+    std::sort(byAge.begin(), byAge.end(), [](const auto &a, const auto &b) {
+        return a->second.lastUsed < b->second.lastUsed;
+    });
+
+    std::error_code error;
+    for (auto entry : byAge) {
+        if (m_totalBytes <= m_maxBytes) {
+            break;
+        }
+
+        std::filesystem::remove(m_directory / entry->first, error);
+        m_totalBytes -= entry->second.bytes;
+        m_entries.erase(entry);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// A directory of finished frame files that persists between runs, keyed by a hash of everything that went into
+// rendering each one. Frames whose inputs haven't changed since an earlier run are copied out of it instead of being
+// rendered. Once the cache grows past its size limit, the least recently used entries are evicted.
+class FrameCache {
+public:
+    using Key = std::uint64_t;
+
+    // Opens (creating if needed) a cache directory and evicts entries until it fits in maxBytes
+    // @return The cache, or null if the directory can't be created.
+    static std::unique_ptr<FrameCache> open(const std::string &directory, std::uintmax_t maxBytes);
+
+    // Copies the entry for key to path, and marks it as recently used
+    // @return Whether there was an entry to copy.
+    bool restore(Key key, const std::string &extension, const std::string &path);
+
+    // Adds a copy of the file at path to the cache under key, evicting older entries to make room.
+    // Safe to call from several threads at once.
+    bool store(Key key, const std::string &extension, const std::string &path);
+
+    // The total size of the entries in the cache
+    std::uintmax_t size() const;
+
+private:
+    struct Entry {
+        std::uintmax_t bytes;
+        std::filesystem::file_time_type lastUsed;
+    };
+
+    FrameCache(const std::filesystem::path &directory, std::uintmax_t maxBytes);
+
+    static std::string entryName(Key key, const std::string &extension);
+    static bool isEntryName(const std::string &name);
+    void evict();
+
+    const std::filesystem::path m_directory;
+    const std::uintmax_t m_maxBytes;
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Entry> m_entries;
+    std::uintmax_t m_totalBytes = 0;
+};
@@ -0,0 +1,53 @@
+#include "framewriter.h"
+
+#include <QImage>
+#include "imagewriter.h"
+
+namespace FrameWriter {
+    bool isFormat(const std::string &format) {
+        return format == "png" || format == "ppm" || format == "raw" || format == "qoi" || isFloat(format);
+    }
+
+    bool isFloat(const std::string &format) {
+        return format == "hdr" || format == "pfm" || format == "exr";
+    }
+
+    /**
+     * @brief writeBytes - writes a tone-mapped frame
+     * @param path - the file to write
+     * @param format - one of the 8-bit formats
+     * @param pixels - width * height pixels, row by row from the top
+     * @param pngQuality - QImage's PNG quality, only used for png
+     * @return whether the file was written
+     */
+    bool writeBytes(const std::string &path, const std::string &format, const RGBA *pixels, int width, int height,
+                    int pngQuality) {
+        if (format == "ppm") {
+            return ImageWriter::writePPM(path, pixels, width, height);
+        } else if (format == "raw") {
+            return ImageWriter::writeRaw(path, pixels, width, height);
+        } else if (format == "qoi") {
+            return ImageWriter::writeQOI(path, pixels, width, height);
+        }
+
+        // QImage only reads the pixels, so it can wrap them without a copy
+        QImage image(reinterpret_cast<const uchar *>(pixels), width, height, QImage::Format_RGBX8888);
+        return image.save(QString::fromStdString(path), "PNG", pngQuality);
+    }
+
+    /**
+     * @brief writeFloat - writes a frame without tone mapping it
+     * @param path - the file to write
+     * @param format - one of the floating-point formats
+     * @param frame - the frame
+     * @return whether the file was written
+     */
+    bool writeFloat(const std::string &path, const std::string &format, const FrameBuffer &frame) {
+        if (format == "pfm") {
+            return ImageWriter::writePFM(path, frame);
+        } else if (format == "exr") {
+            return ImageWriter::writeEXR(path, frame);
+        }
+        return ImageWriter::writeHDR(path, frame);
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include "utils/framebuffer.h"
+#include "utils/rgba.h"
+
+// Writes a whole frame in any of the output formats named in config files
+namespace FrameWriter {
+    // Whether a format is known, and whether it keeps the frame's floating-point values instead of tone-mapped ones
+    bool isFormat(const std::string &format);
+    bool isFloat(const std::string &format);
+
+    // 8-bit formats: png, ppm, raw and qoi. pngQuality is QImage's, from 0 to 100, or -1 for its default.
+    bool writeBytes(const std::string &path, const std::string &format, const RGBA *pixels, int width, int height,
+                    int pngQuality);
+
+    // Floating-point formats: hdr, pfm and exr
+    bool writeFloat(const std::string &path, const std::string &format, const FrameBuffer &frame);
+}
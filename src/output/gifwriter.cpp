@@ -0,0 +1,584 @@
+#include "gifwriter.h"
+
+#include "utils/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// The 8x8 Bayer threshold matrix used for ordered dithering
+static const int BAYER[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+// How far (in 8-bit levels) the dither may push a channel either way. About the spacing of a 256 color palette.
+static const int DITHER_SPREAD = 24;
+
+// The LZW dictionary can't grow past 12-bit codes
+static const int LZW_MAX_CODE = 4095;
+static const int LZW_HASH_SIZE = 5003;
+
+/**
+ * @brief binOf - the histogram bin a color falls in, keeping the top HISTOGRAM_BITS of each channel
+ */
+static int binOf(int r, int g, int b) {
+    return ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+}
+
+/**
+ * @brief putShort - appends a 16-bit little-endian value, which is how GIF stores every multi-byte field
+ */
+static void putShort(std::vector<std::uint8_t> &bytes, int value) {
+    bytes.push_back(value & 0xff);
+    bytes.push_back((value >> 8) & 0xff);
+}
+
+/**
+ * @brief tableBits - the number of bits needed to index a palette, since GIF color tables are sized in powers of two
+ */
+static int tableBits(const std::vector<RGBA> &palette) {
+    int bits = 1;
+    while ((1 << bits) < int(palette.size())) {
+        bits++;
+    }
+    return bits;
+}
+
+GifWriter::GifWriter(std::FILE *file, int width, int height, int framerate, const Config &config) :
+    m_file(file),
+    m_width(width),
+    m_height(height),
+    m_delay(std::max(1, (int) std::lround(100.0 / std::max(framerate, 1)))),
+    m_config(config)
+{
+    if (m_config.globalPalette) {
+        m_histogram.resize(HISTOGRAM_SIZE);
+    }
+}
+
+GifWriter::~GifWriter() {
+    close();
+}
+
+/**
+ * @brief GifWriter::open - create a GIF file to add frames to
+ * @param path - the file to write
+ * @param width - the width of every frame
+ * @param height - the height of every frame
+ * @param framerate - the frames per second of the animation
+ * @param config - the encoder settings
+ * @return the writer, or null if the file couldn't be opened
+ */
+std::unique_ptr<GifWriter> GifWriter::open(const std::string &path, int width, int height, int framerate, const Config &config) {
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr<GifWriter> writer(new GifWriter(file, width, height, framerate, config));
+
+    // with a global palette the header has to wait until the palette is known
+    if (!config.globalPalette && !writer->writeHeader(nullptr)) {
+        return nullptr;
+    }
+
+    return writer;
+}
+
+/**
+ * @brief GifWriter::addFrame - quantize and encode the next frame of the animation
+ * @param pixels - the frame, width * height pixels starting from the top row
+ * @return whether the frame was written (or held, with a global palette)
+ */
+bool GifWriter::addFrame(const RGBA *pixels) {
+    if (m_file == nullptr || !m_ok) {
+        return false;
+    }
+
+    if (m_config.globalPalette) {
+        addToHistogram(pixels, m_histogram);
+        m_heldFrames.emplace_back(pixels, pixels + std::size_t(m_width) * m_height);
+        return true;
+    }
+
+    Histogram histogram(HISTOGRAM_SIZE);
+    addToHistogram(pixels, histogram);
+
+    Palette palette = buildPalette(histogram);
+    return encodeFrame(pixels, palette, buildLookup(palette), true);
+}
+
+/**
+ * @brief GifWriter::close - encode any held frames, then finish and close the file. Safe to call more than once.
+ * @return whether the whole file was written
+ */
+bool GifWriter::close() {
+    if (m_file == nullptr) {
+        return m_ok;
+    }
+
+    if (m_config.globalPalette && m_ok) {
+        Palette palette = buildPalette(m_histogram);
+        std::vector<std::uint8_t> lookup = buildLookup(palette);
+
+        if (writeHeader(&palette)) {
+            for (const std::vector<RGBA> &frame : m_heldFrames) {
+                if (!encodeFrame(frame.data(), palette, lookup, false)) {
+                    break;
+                }
+            }
+        }
+
+        m_heldFrames.clear();
+    }
+
+    if (m_ok) {
+        writeBytes({ 0x3b });
+    }
+
+    m_ok = (std::fclose(m_file) == 0) && m_ok;
+    m_file = nullptr;
+    return m_ok;
+}
+
+/**
+ * @brief GifWriter::addToHistogram - counts the colors of a frame into a histogram. Bands of the frame are counted
+ * concurrently into their own histograms, which are then merged.
+ */
+void GifWriter::addToHistogram(const RGBA *pixels, Histogram &histogram) const {
+    // a few tall bands rather than many short ones, since every band needs a histogram of its own
+    const int bandHeight = std::max(Parallel::DEFAULT_BAND_HEIGHT, (m_height + 7) / 8);
+    const int numBands = (m_height + bandHeight - 1) / bandHeight;
+
+    std::vector<Histogram> bandHistograms(numBands, Histogram(HISTOGRAM_SIZE));
+
+    Parallel::forEachBand(m_height, true, [&](int rowStart, int rowEnd) {
+        Histogram &local = bandHistograms[rowStart / bandHeight];
+
+        for (int i = rowStart * m_width; i < rowEnd * m_width; i++) {
+            const RGBA &pixel = pixels[i];
+            Bin &bin = local[binOf(pixel.r, pixel.g, pixel.b)];
+            bin.count++;
+            bin.r += pixel.r;
+            bin.g += pixel.g;
+            bin.b += pixel.b;
+        }
+    }, bandHeight);
+
+    for (const Histogram &local : bandHistograms) {
+        for (int i = 0; i < HISTOGRAM_SIZE; i++) {
+            histogram[i].count += local[i].count;
+            histogram[i].r += local[i].r;
+            histogram[i].g += local[i].g;
+            histogram[i].b += local[i].b;
+        }
+    }
+}
+
+/**
+ * @brief GifWriter::buildPalette - reduces a histogram to at most 256 colors with median cut. The box whose longest
+ * side (weighted by how many pixels it holds) is biggest is repeatedly split at the median of that side, and each
+ * final box contributes the average of its colors.
+ */
+GifWriter::Palette GifWriter::buildPalette(const Histogram &histogram) {
+    struct Box {
+        int start, end; // The range of bins in the box
+        std::uint64_t count;
+    };
+
+    auto coordinate = [](int bin, int axis) {
+        return (bin >> (10 - 5 * axis)) & 31;
+    };
+
+    std::vector<int> bins;
+    for (int i = 0; i < HISTOGRAM_SIZE; i++) {
+        if (histogram[i].count > 0) {
+            bins.push_back(i);
+        }
+    }
+
+    if (bins.empty()) {
+        return Palette{ RGBA{ 0, 0, 0 } };
+    }
+
+    std::vector<Box> boxes;
+    std::uint64_t total = 0;
+    for (int bin : bins) {
+        total += histogram[bin].count;
+    }
+    boxes.push_back(Box{ 0, int(bins.size()), total });
+
+    while (boxes.size() < 256) {
+        // find the box most worth splitting, and its longest side
+        int best = -1;
+        int bestAxis = 0;
+        double bestScore = 0.0;
+
+        for (int i = 0; i < int(boxes.size()); i++) {
+            const Box &box = boxes[i];
+            if (box.end - box.start < 2) {
+                continue;
+            }
+
+            for (int axis = 0; axis < 3; axis++) {
+                int low = 31, high = 0;
+                for (int j = box.start; j < box.end; j++) {
+                    low = std::min(low, coordinate(bins[j], axis));
+                    high = std::max(high, coordinate(bins[j], axis));
+                }
+
+                double score = double(high - low) * std::sqrt(double(box.count));
+                if (high > low && score > bestScore) {
+                    best = i;
+                    bestAxis = axis;
+                    bestScore = score;
+                }
+            }
+        }
+
+        if (best < 0) {
+            break;
+        }
+
+        // split at the median pixel (not the median bin) along that side
+        Box box = boxes[best];
+        std::sort(bins.begin() + box.start, bins.begin() + box.end, [&](int a, int b) {
+            return coordinate(a, bestAxis) < coordinate(b, bestAxis);
+        });
+
+        std::uint64_t running = 0;
+        int split = box.start + 1;
+        for (int j = box.start; j < box.end - 1; j++) {
+            running += histogram[bins[j]].count;
+            split = j + 1;
+            if (running * 2 >= box.count) {
+                break;
+            }
+        }
+
+        std::uint64_t lowerCount = 0;
+        for (int j = box.start; j < split; j++) {
+            lowerCount += histogram[bins[j]].count;
+        }
+
+        boxes[best] = Box{ box.start, split, lowerCount };
+        boxes.push_back(Box{ split, box.end, box.count - lowerCount });
+    }
+
+    Palette palette;
+    for (const Box &box : boxes) {
+        std::uint64_t r = 0, g = 0, b = 0;
+        for (int j = box.start; j < box.end; j++) {
+            r += histogram[bins[j]].r;
+            g += histogram[bins[j]].g;
+            b += histogram[bins[j]].b;
+        }
+
+        palette.push_back(RGBA{ std::uint8_t(r / box.count), std::uint8_t(g / box.count), std::uint8_t(b / box.count) });
+    }
+
+    return palette;
+}
+
+/**
+ * @brief GifWriter::buildLookup - maps every histogram bin to its nearest palette color, so that indexing a pixel is
+ * a single table load. The table is filled concurrently.
+ */
+std::vector<std::uint8_t> GifWriter::buildLookup(const Palette &palette) {
+    std::vector<std::uint8_t> lookup(HISTOGRAM_SIZE);
+
+    // one "row" per red level
+    Parallel::forEachBand(1 << HISTOGRAM_BITS, true, [&](int rStart, int rEnd) {
+        for (int rBin = rStart; rBin < rEnd; rBin++) {
+            for (int gBin = 0; gBin < (1 << HISTOGRAM_BITS); gBin++) {
+                for (int bBin = 0; bBin < (1 << HISTOGRAM_BITS); bBin++) {
+                    // the center of the bin
+                    int r = (rBin << 3) + 4;
+                    int g = (gBin << 3) + 4;
+                    int b = (bBin << 3) + 4;
+
+                    int nearest = 0;
+                    int nearestDistance = std::numeric_limits<int>::max();
+                    for (int i = 0; i < int(palette.size()); i++) {
+                        int dr = r - palette[i].r;
+                        int dg = g - palette[i].g;
+                        int db = b - palette[i].b;
+                        int distance = dr * dr + dg * dg + db * db;
+
+                        if (distance < nearestDistance) {
+                            nearest = i;
+                            nearestDistance = distance;
+                        }
+                    }
+
+                    lookup[(rBin << 10) | (gBin << 5) | bBin] = std::uint8_t(nearest);
+                }
+            }
+        }
+    }, 1);
+
+    return lookup;
+}
+
+/**
+ * @brief GifWriter::indexFrame - converts a frame to palette indices, dithering it first if enabled
+ */
+std::vector<std::uint8_t> GifWriter::indexFrame(const RGBA *pixels, const std::vector<std::uint8_t> &lookup) const {
+    std::vector<std::uint8_t> indices(std::size_t(m_width) * m_height);
+
+    Parallel::forEachBand(m_height, true, [&](int rowStart, int rowEnd) {
+        for (int row = rowStart; row < rowEnd; row++) {
+            for (int col = 0; col < m_width; col++) {
+                const int index = row * m_width + col;
+                const RGBA &pixel = pixels[index];
+
+                if (!m_config.dither) {
+                    indices[index] = lookup[binOf(pixel.r, pixel.g, pixel.b)];
+                    continue;
+                }
+
+                // the threshold matrix centered on 0, scaled to the dither spread
+                int offset = ((2 * BAYER[row & 7][col & 7] + 1) * DITHER_SPREAD) / 128 - DITHER_SPREAD / 2;
+                indices[index] = lookup[binOf(std::clamp(pixel.r + offset, 0, 255),
+                                              std::clamp(pixel.g + offset, 0, 255),
+                                              std::clamp(pixel.b + offset, 0, 255))];
+            }
+        }
+    });
+
+    return indices;
+}
+
+/**
+ * @brief GifWriter::encodeFrame - indexes a frame and writes it, trimmed to the rectangle that changed since the
+ * previous frame when delta frames are enabled
+ * @param pixels - the frame to write
+ * @param palette - the palette to index the frame with
+ * @param lookup - the bin to palette index table for that palette
+ * @param localPalette - whether to write the palette with the frame (instead of using the global one)
+ * @return whether the frame was written
+ */
+bool GifWriter::encodeFrame(const RGBA *pixels, const Palette &palette, const std::vector<std::uint8_t> &lookup, bool localPalette) {
+    std::vector<std::uint8_t> indices = indexFrame(pixels, lookup);
+
+    int left = 0, top = 0, right = m_width, bottom = m_height;
+
+    if (m_config.deltaFrames && m_hasPrevious) {
+        // compare what the viewer will see, since per-frame palettes mean the same index isn't the same color
+        left = m_width;
+        top = m_height;
+        right = 0;
+        bottom = 0;
+
+        for (int row = 0; row < m_height; row++) {
+            for (int col = 0; col < m_width; col++) {
+                const RGBA &shown = m_previous[row * m_width + col];
+                const RGBA &next = palette[indices[row * m_width + col]];
+
+                if (shown.r != next.r || shown.g != next.g || shown.b != next.b) {
+                    left = std::min(left, col);
+                    right = std::max(right, col + 1);
+                    top = std::min(top, row);
+                    bottom = std::max(bottom, row + 1);
+                }
+            }
+        }
+
+        // nothing changed, but the frame still has to take up its time on screen
+        if (right <= left) {
+            left = top = 0;
+            right = bottom = 1;
+        }
+    }
+
+    if (m_config.deltaFrames) {
+        if (!m_hasPrevious) {
+            m_previous.resize(std::size_t(m_width) * m_height);
+            m_hasPrevious = true;
+        }
+
+        for (int row = top; row < bottom; row++) {
+            for (int col = left; col < right; col++) {
+                m_previous[row * m_width + col] = palette[indices[row * m_width + col]];
+            }
+        }
+    }
+
+    std::vector<std::uint8_t> bytes;
+
+    // graphic control extension: keep the previous frame underneath (disposal 1) and set the delay
+    bytes.insert(bytes.end(), { 0x21, 0xf9, 0x04, 0x04 });
+    putShort(bytes, m_delay);
+    bytes.insert(bytes.end(), { 0x00, 0x00 });
+
+    // image descriptor
+    bytes.push_back(0x2c);
+    putShort(bytes, left);
+    putShort(bytes, top);
+    putShort(bytes, right - left);
+    putShort(bytes, bottom - top);
+
+    int bits = tableBits(palette);
+    if (localPalette) {
+        bytes.push_back(0x80 | (bits - 1));
+        writePalette(bytes, palette);
+    } else {
+        bytes.push_back(0x00);
+    }
+
+    compress(indices.data(), m_width, left, top, right - left, bottom - top, std::max(2, bits), bytes);
+
+    return writeBytes(bytes);
+}
+
+/**
+ * @brief GifWriter::writeHeader - writes the file header, the global palette (if there is one) and the loop count
+ */
+bool GifWriter::writeHeader(const Palette *globalPalette) {
+    std::vector<std::uint8_t> bytes = { 'G', 'I', 'F', '8', '9', 'a' };
+
+    // logical screen descriptor
+    putShort(bytes, m_width);
+    putShort(bytes, m_height);
+    bytes.push_back(globalPalette ? 0xf0 | (tableBits(*globalPalette) - 1) : 0x70);
+    bytes.push_back(0x00);
+    bytes.push_back(0x00);
+
+    if (globalPalette) {
+        writePalette(bytes, *globalPalette);
+    }
+
+    // the NETSCAPE2.0 extension holds the number of times to repeat, which isn't needed to play once
+    if (m_config.loops != 1) {
+        bytes.insert(bytes.end(), { 0x21, 0xff, 0x0b, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01 });
+        putShort(bytes, std::max(m_config.loops - 1, 0));
+        bytes.push_back(0x00);
+    }
+
+    return writeBytes(bytes);
+}
+
+/**
+ * @brief GifWriter::writeBytes - writes a block of the file in a single call
+ */
+bool GifWriter::writeBytes(const std::vector<std::uint8_t> &bytes) {
+    m_ok = m_ok && std::fwrite(bytes.data(), 1, bytes.size(), m_file) == bytes.size();
+    return m_ok;
+}
+
+/**
+ * @brief GifWriter::writePalette - appends a color table, padded with black to a power of two entries
+ */
+void GifWriter::writePalette(std::vector<std::uint8_t> &bytes, const Palette &palette) {
+    for (const RGBA &color : palette) {
+        bytes.insert(bytes.end(), { color.r, color.g, color.b });
+    }
+
+    bytes.resize(bytes.size() + 3 * ((1 << tableBits(palette)) - palette.size()), 0);
+}
+
+/**
+ * @brief GifWriter::compress - LZW-compresses a rectangle of palette indices into GIF image data sub-blocks
+ * @param indices - the palette indices of the whole frame
+ * @param stride - the width of the whole frame
+ * @param left - the first column of the rectangle
+ * @param top - the first row of the rectangle
+ * @param width - the width of the rectangle
+ * @param height - the height of the rectangle
+ * @param minCodeSize - the number of bits in a palette index (at least 2)
+ * @param bytes - where to append the compressed data
+ */
+void GifWriter::compress(const std::uint8_t *indices, int stride, int left, int top, int width, int height,
+                         int minCodeSize, std::vector<std::uint8_t> &bytes) {
+    const int clearCode = 1 << minCodeSize;
+    const int endCode = clearCode + 1;
+
+    int codeSize = minCodeSize + 1;
+    int nextCode = endCode + 1;
+
+    // the dictionary, as an open-addressed hash from (prefix code, next index) to code
+    std::vector<int> keys(LZW_HASH_SIZE, -1);
+    std::vector<int> codes(LZW_HASH_SIZE);
+
+    std::vector<std::uint8_t> packed;
+    std::uint32_t bitBuffer = 0;
+    int bitCount = 0;
+
+    auto emit = [&](int code) {
+        bitBuffer |= std::uint32_t(code) << bitCount;
+        bitCount += codeSize;
+        while (bitCount >= 8) {
+            packed.push_back(bitBuffer & 0xff);
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    };
+
+    emit(clearCode);
+
+    int prefix = indices[top * stride + left];
+    for (int row = top; row < top + height; row++) {
+        for (int col = (row == top ? left + 1 : left); col < left + width; col++) {
+            const int next = indices[row * stride + col];
+            const int key = (next << 12) | prefix;
+
+            int slot = ((next << 4) ^ prefix) % LZW_HASH_SIZE;
+            const int step = slot == 0 ? 1 : LZW_HASH_SIZE - slot;
+            while (keys[slot] != -1 && keys[slot] != key) {
+                slot -= step;
+                if (slot < 0) {
+                    slot += LZW_HASH_SIZE;
+                }
+            }
+
+            if (keys[slot] == key) {
+                prefix = codes[slot];
+                continue;
+            }
+
+            emit(prefix);
+
+            // the decoder widens its codes one step behind the encoder adding them
+            if (nextCode >= (1 << codeSize) && codeSize < 12) {
+                codeSize++;
+            }
+
+            if (nextCode < LZW_MAX_CODE) {
+                keys[slot] = key;
+                codes[slot] = nextCode++;
+            } else {
+                // the dictionary is full, so start a new one
+                emit(clearCode);
+                std::fill(keys.begin(), keys.end(), -1);
+                codeSize = minCodeSize + 1;
+                nextCode = endCode + 1;
+            }
+
+            prefix = next;
+        }
+    }
+
+    emit(prefix);
+    if (nextCode >= (1 << codeSize) && codeSize < 12) {
+        codeSize++;
+    }
+    emit(endCode);
+    if (bitCount > 0) {
+        packed.push_back(bitBuffer & 0xff);
+    }
+
+    // the data is split into sub-blocks of at most 255 bytes, each prefixed by its length
+    bytes.push_back(std::uint8_t(minCodeSize));
+    for (std::size_t offset = 0; offset < packed.size(); offset += 255) {
+        std::size_t length = std::min<std::size_t>(255, packed.size() - offset);
+        bytes.push_back(std::uint8_t(length));
+        bytes.insert(bytes.end(), packed.begin() + offset, packed.begin() + offset + length);
+    }
+    bytes.push_back(0x00);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "utils/rgba.h"
+
+// An animated GIF encoder. Frames are reduced to (at most) 256 colors with median-cut quantization, optionally with
+// ordered dithering, and each frame after the first only re-encodes the rectangle that changed since the last one.
+class GifWriter {
+public:
+    struct Config {
+        bool globalPalette = false; // Share one palette across every frame, built from all of them (frames are held until close)
+        bool dither        = true;  // Apply an ordered (Bayer) dither to hide banding from the reduced palette
+        bool deltaFrames   = true;  // Only encode the region of each frame that differs from the previous one
+        int  loops         = 0;     // Number of times to play the animation, where 0 loops forever
+    };
+
+    // Opens a GIF file and writes its header
+    static std::unique_ptr<GifWriter> open(const std::string &path, int width, int height, int framerate, const Config &config);
+
+    ~GifWriter();
+
+    // Adds the next frame to the animation. Frames must be added in order, one at a time.
+    bool addFrame(const RGBA *pixels);
+
+    // Writes any held frames and the trailer, and closes the file
+    // @return Whether the whole file was written
+    bool close();
+
+private:
+    static const int HISTOGRAM_BITS = 5;
+    static const int HISTOGRAM_SIZE = 1 << (3 * HISTOGRAM_BITS);
+
+    struct Bin {
+        std::uint64_t count = 0;
+        std::uint64_t r = 0, g = 0, b = 0;
+    };
+
+    using Histogram = std::vector<Bin>;
+    using Palette = std::vector<RGBA>;
+
+    GifWriter(std::FILE *file, int width, int height, int framerate, const Config &config);
+
+    void addToHistogram(const RGBA *pixels, Histogram &histogram) const;
+    static Palette buildPalette(const Histogram &histogram);
+    static std::vector<std::uint8_t> buildLookup(const Palette &palette);
+    std::vector<std::uint8_t> indexFrame(const RGBA *pixels, const std::vector<std::uint8_t> &lookup) const;
+
+    bool encodeFrame(const RGBA *pixels, const Palette &palette, const std::vector<std::uint8_t> &lookup, bool localPalette);
+    bool writeHeader(const Palette *globalPalette);
+    bool writeBytes(const std::vector<std::uint8_t> &bytes);
+    static void writePalette(std::vector<std::uint8_t> &bytes, const Palette &palette);
+    static void compress(const std::uint8_t *indices, int stride, int left, int top, int width, int height,
+                         int minCodeSize, std::vector<std::uint8_t> &bytes);
+
+    std::FILE *m_file;
+    const int m_width;
+    const int m_height;
+    const int m_delay; // In hundredths of a second
+    const Config m_config;
+    bool m_ok = true;
+
+    // The colors currently on screen, which the next frame's changed rectangle is found against
+    std::vector<RGBA> m_previous;
+    bool m_hasPrevious = false;
+
+    // With a global palette, frames are held until every frame has contributed to the palette
+    Histogram m_histogram;
+    std::vector<std::vector<RGBA>> m_heldFrames;
+};
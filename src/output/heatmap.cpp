@@ -0,0 +1,145 @@
+#include "heatmap.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace Heatmap {
+    namespace {
+        // Evenly spaced stops along the color scale, after matplotlib's inferno
+        const std::array<glm::vec3, 5> STOPS = {
+            glm::vec3(0, 0, 4), glm::vec3(87, 16, 110), glm::vec3(188, 55, 84), glm::vec3(249, 142, 9),
+            glm::vec3(252, 255, 164)
+        };
+
+        // The units a channel is measured in, as a suffix for its values
+        const char *unitOf(AOV::Channel channel) {
+            return channel == AOV::TIME ? " us" : "";
+        }
+    }
+
+    /**
+     * @brief scale - finds the value at a percentile of a channel's pixels, to map to the top of the color scale
+     * @param values - the channel
+     * @param count - the number of pixels
+     * @param percentile - from 0 to 100
+     * @return the value, or the largest value if that is 0, or 1 if every value is 0
+     */
+    float scale(const float *values, int count, float percentile) {
+        if (count <= 0) {
+            return 1.f;
+        }
+
+        std::vector<float> sorted(values, values + count);
+        const int rank = std::clamp(int(std::lround(percentile / 100.f * (count - 1))), 0, count - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        if (sorted[rank] > 0.f) {
+            return sorted[rank];
+        }
+
+        const float largest = *std::max_element(sorted.begin(), sorted.end());
+        return largest > 0.f ? largest : 1.f;
+    }
+
+    /**
+     * @brief colorize - maps a channel onto the false-color scale
+     * @param values - the channel
+     * @param count - the number of pixels
+     * @param scale - the value at the top of the scale
+     * @param pixels - filled with count colors
+     */
+    void colorize(const float *values, int count, float scale, RGBA *pixels) {
+        const float segments = float(STOPS.size() - 1);
+        for (int i = 0; i < count; i++) {
+            const float position = std::clamp(values[i] / scale, 0.f, 1.f) * segments;
+            const int stop = std::min(int(position), int(STOPS.size()) - 2);
+            const glm::vec3 color = glm::mix(STOPS[stop], STOPS[stop + 1], position - stop);
+            pixels[i] = RGBA{ std::uint8_t(color.r + 0.5f), std::uint8_t(color.g + 0.5f), std::uint8_t(color.b + 0.5f) };
+        }
+    }
+
+    /**
+     * @brief report - summarizes the cost channels of a frame, and the objects that cost the most
+     * @param aovs - the frame's channels
+     * @param channels - the cost channels to report on
+     * @param percentile - the percentile the heatmaps are scaled to
+     * @param objects - the number of objects to list
+     * @param describe - names an object by its primitive id
+     * @return the summary, one line per channel and object
+     */
+    std::string report(const AOV::Buffers &aovs, unsigned channels, float percentile, int objects,
+                       const std::function<std::string(int)> &describe) {
+        const int count = aovs.width * aovs.height;
+        std::vector<AOV::Channel> costs;
+        for (AOV::Channel channel : AOV::ALL_CHANNELS) {
+            if ((channels & channel) && (channel & AOV::COST_CHANNELS) && aovs.has(channel)) {
+                costs.push_back(channel);
+            }
+        }
+
+        std::ostringstream text;
+        char line[256];
+        std::vector<double> totals(costs.size(), 0.0);
+        for (std::size_t c = 0; c < costs.size(); c++) {
+            const float *values = aovs.data(costs[c]);
+            float largest = 0.f;
+            for (int i = 0; i < count; i++) {
+                totals[c] += values[i];
+                largest = std::max(largest, values[i]);
+            }
+            std::snprintf(line, sizeof(line), "  %-14s mean %10.2f%s, max %10.2f%s, p%g %10.2f%s\n",
+                          AOV::channelName(costs[c]).c_str(), count > 0 ? totals[c] / count : 0.0, unitOf(costs[c]),
+                          largest, unitOf(costs[c]), percentile, scale(values, count, percentile), unitOf(costs[c]));
+            text << line;
+        }
+
+        if (objects <= 0 || costs.empty() || !aovs.has(AOV::PRIMITIVE_ID)) {
+            return text.str();
+        }
+
+        // add up every channel over the pixels of each object, with -1 for pixels that hit nothing
+        struct Object {
+            int pixels = 0;
+            std::vector<double> totals;
+        };
+        std::map<int, Object> byPrimitive;
+        for (int i = 0; i < count; i++) {
+            Object &object = byPrimitive[int(aovs.primitiveId[i])];
+            object.totals.resize(costs.size(), 0.0);
+            object.pixels++;
+            for (std::size_t c = 0; c < costs.size(); c++) {
+                object.totals[c] += aovs.data(costs[c])[i];
+            }
+        }
+
+        std::vector<std::pair<int, Object>> ranked(byPrimitive.begin(), byPrimitive.end());
+        std::sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b) {
+            return a.second.totals[0] > b.second.totals[0];
+        });
+        ranked.resize(std::min<std::size_t>(ranked.size(), objects));
+
+        std::snprintf(line, sizeof(line), "  %-36s %8s", "share of the frame by object", "pixels");
+        text << line;
+        for (AOV::Channel channel : costs) {
+            std::snprintf(line, sizeof(line), " %14s", AOV::channelName(channel).c_str());
+            text << line;
+        }
+        text << "\n";
+
+        for (const auto &[primitive, object] : ranked) {
+            const std::string name = primitive < 0 ? "background" : describe(primitive);
+            std::snprintf(line, sizeof(line), "  %-36s %7.1f%%", name.c_str(), 100.0 * object.pixels / count);
+            text << line;
+            for (std::size_t c = 0; c < costs.size(); c++) {
+                std::snprintf(line, sizeof(line), " %13.1f%%", totals[c] > 0 ? 100.0 * object.totals[c] / totals[c] : 0.0);
+                text << line;
+            }
+            text << "\n";
+        }
+        return text.str();
+    }
+}
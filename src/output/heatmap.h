@@ -0,0 +1,28 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include "utils/aov.h"
+#include "utils/rgba.h"
+
+// False-color images of the cost channels of a render (AOV::COST_CHANNELS), and a summary of which objects in the
+// frame the cost goes to, so the expensive parts of a shot stand out at a glance
+namespace Heatmap {
+    // The value at a percentile of a channel's pixels. Mapping it to the top of the color scale, rather than the
+    // largest value, keeps a handful of outliers from leaving the rest of the image dark.
+    float scale(const float *values, int count, float percentile);
+
+    // Colors values from 0 to scale from black through purple and orange to pale yellow; anything above scale is
+    // the top color
+    void colorize(const float *values, int count, float scale, RGBA *pixels);
+
+    // A table of each cost channel's mean and color scale, followed by the objects whose pixels cost the most, with
+    // their share of the frame's pixels next to their share of each channel. Each pixel's cost is put down to the
+    // object its camera ray hit first, so the cost of reflections lands on the reflective object.
+    // @param channels The cost channels to report on, in the order ALL_CHANNELS lists them.
+    // @param objects How many objects to list. Objects need the PRIMITIVE_ID channel, and are ranked by the first
+    // of the channels.
+    // @param describe Names the object with a given primitive id.
+    std::string report(const AOV::Buffers &aovs, unsigned channels, float percentile, int objects,
+                       const std::function<std::string(int)> &describe);
+}
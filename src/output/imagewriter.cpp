@@ -0,0 +1,403 @@
+#include "imagewriter.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace ImageWriter {
+    /**
+     * @brief writeFile - writes a fully built file to disk in a single call
+     * @return whether the file was written successfully
+     */
+    static bool writeFile(const std::string &path, const std::vector<std::uint8_t> &bytes) {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+
+        return file.good();
+    }
+
+    /**
+     * @brief putInt - appends a 32-bit little-endian value
+     */
+    static void putInt(std::vector<std::uint8_t> &bytes, std::uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            bytes.push_back((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    /**
+     * @brief putFloat - appends a 32-bit little-endian float
+     */
+    static void putFloat(std::vector<std::uint8_t> &bytes, float value) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        putInt(bytes, bits);
+    }
+
+    /**
+     * @brief appendRGB - appends the RGB channels of every pixel, dropping alpha
+     */
+    static void appendRGB(std::vector<std::uint8_t> &bytes, const RGBA *pixels, int width, int height) {
+        std::size_t offset = bytes.size();
+        std::size_t count = std::size_t(width) * height;
+        bytes.resize(offset + 3 * count);
+
+        for (std::size_t i = 0; i < count; i++) {
+            bytes[offset + 3 * i + 0] = pixels[i].r;
+            bytes[offset + 3 * i + 1] = pixels[i].g;
+            bytes[offset + 3 * i + 2] = pixels[i].b;
+        }
+    }
+
+    /**
+     * @brief writeRaw - writes a frame as bare 8-bit RGB triples with no header, the cheapest format there is
+     * @param path - the file to write
+     * @param pixels - width * height pixels starting at the top row
+     * @param width - the width of the image
+     * @param height - the height of the image
+     * @return whether the file was written successfully
+     */
+    bool writeRaw(const std::string &path, const RGBA *pixels, int width, int height) {
+        std::vector<std::uint8_t> bytes;
+        appendRGB(bytes, pixels, width, height);
+
+        return writeFile(path, bytes);
+    }
+
+    /**
+     * @brief writePPM - writes a frame as a binary (P6) Portable Pixmap, which is raw RGB behind a tiny header
+     * @param path - the file to write
+     * @param pixels - width * height pixels starting at the top row
+     * @param width - the width of the image
+     * @param height - the height of the image
+     * @return whether the file was written successfully
+     */
+    bool writePPM(const std::string &path, const RGBA *pixels, int width, int height) {
+        std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+
+        std::vector<std::uint8_t> bytes(header.begin(), header.end());
+        appendRGB(bytes, pixels, width, height);
+
+        return writeFile(path, bytes);
+    }
+
+    QOIEncoder::QOIEncoder() :
+        m_previous{ 0, 0, 0, 255 }
+    {
+        // the color cache starts out zeroed, including alpha
+        for (RGBA &color : m_seen) {
+            color = RGBA{ 0, 0, 0, 0 };
+        }
+    }
+
+    /**
+     * @brief QOIEncoder::appendHeader - appends the header of a 3 channel, sRGB QOI image
+     */
+    void QOIEncoder::appendHeader(std::vector<std::uint8_t> &bytes, int width, int height) {
+        bytes.insert(bytes.end(), { 'q', 'o', 'i', 'f' });
+
+        // QOI stores the dimensions big-endian
+        for (std::uint32_t dimension : { std::uint32_t(width), std::uint32_t(height) }) {
+            for (int shift = 24; shift >= 0; shift -= 8) {
+                bytes.push_back((dimension >> shift) & 0xff);
+            }
+        }
+
+        bytes.push_back(3);
+        bytes.push_back(0);
+    }
+
+    /**
+     * @brief QOIEncoder::append - encodes the next pixels of the image, picking up where the last call left off
+     * @param bytes - where to append the encoded pixels
+     * @param pixels - the pixels to encode
+     * @param count - the number of pixels
+     */
+    void QOIEncoder::append(std::vector<std::uint8_t> &bytes, const RGBA *pixels, std::size_t count) {
+        const std::uint8_t OP_INDEX = 0x00;
+        const std::uint8_t OP_DIFF  = 0x40;
+        const std::uint8_t OP_LUMA  = 0x80;
+        const std::uint8_t OP_RUN   = 0xc0;
+        const std::uint8_t OP_RGB   = 0xfe;
+
+        for (std::size_t i = 0; i < count; i++) {
+            // the alpha channel isn't written, so treat every pixel as opaque
+            const RGBA pixel{ pixels[i].r, pixels[i].g, pixels[i].b, 255 };
+
+            if (pixel.r == m_previous.r && pixel.g == m_previous.g && pixel.b == m_previous.b) {
+                m_run++;
+                if (m_run == 62) {
+                    bytes.push_back(OP_RUN | (m_run - 1));
+                    m_run = 0;
+                }
+                continue;
+            }
+
+            if (m_run > 0) {
+                bytes.push_back(OP_RUN | (m_run - 1));
+                m_run = 0;
+            }
+
+            const int hash = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+            const RGBA &cached = m_seen[hash];
+
+            if (cached.r == pixel.r && cached.g == pixel.g && cached.b == pixel.b && cached.a == pixel.a) {
+                bytes.push_back(OP_INDEX | hash);
+            } else {
+                m_seen[hash] = pixel;
+
+                const int dr = std::int8_t(pixel.r - m_previous.r);
+                const int dg = std::int8_t(pixel.g - m_previous.g);
+                const int db = std::int8_t(pixel.b - m_previous.b);
+                const int drg = dr - dg;
+                const int dbg = db - dg;
+
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    bytes.push_back(OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                    bytes.push_back(OP_LUMA | (dg + 32));
+                    bytes.push_back(((drg + 8) << 4) | (dbg + 8));
+                } else {
+                    bytes.insert(bytes.end(), { OP_RGB, pixel.r, pixel.g, pixel.b });
+                }
+            }
+
+            m_previous = pixel;
+        }
+    }
+
+    /**
+     * @brief QOIEncoder::finish - ends any run still in progress and appends the end marker
+     */
+    void QOIEncoder::finish(std::vector<std::uint8_t> &bytes) {
+        if (m_run > 0) {
+            bytes.push_back(0xc0 | (m_run - 1));
+            m_run = 0;
+        }
+
+        bytes.insert(bytes.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+    }
+
+    /**
+     * @brief writeQOI - writes a frame in the "Quite OK Image" format, a lossless format that compresses with a
+     * single pass of byte-level runs, color cache hits and small deltas instead of deflate
+     * @param path - the file to write
+     * @param pixels - width * height pixels starting at the top row
+     * @param width - the width of the image
+     * @param height - the height of the image
+     * @return whether the file was written successfully
+     */
+    bool writeQOI(const std::string &path, const RGBA *pixels, int width, int height) {
+        std::vector<std::uint8_t> bytes;
+        bytes.reserve(14 + 4 * std::size_t(width) * height + 8);
+
+        QOIEncoder encoder;
+        QOIEncoder::appendHeader(bytes, width, height);
+        encoder.append(bytes, pixels, std::size_t(width) * height);
+        encoder.finish(bytes);
+
+        return writeFile(path, bytes);
+    }
+
+    /**
+     * @brief toRGBE - packs a linear color into Radiance's shared-exponent format
+     * @param color - a linear color, only the RGB channels are used
+     * @param out - 4 bytes to write the packed color into
+     */
+    static void toRGBE(const glm::vec4 &color, std::uint8_t *out) {
+        float r = fmax(color.r, 0.f);
+        float g = fmax(color.g, 0.f);
+        float b = fmax(color.b, 0.f);
+        float v = fmax(r, fmax(g, b));
+
+        if (v < 1e-32f) {
+            out[0] = out[1] = out[2] = out[3] = 0;
+            return;
+        }
+
+        int exponent;
+        float scale = frexpf(v, &exponent) * 256.f / v;
+
+        out[0] = (std::uint8_t) (r * scale);
+        out[1] = (std::uint8_t) (g * scale);
+        out[2] = (std::uint8_t) (b * scale);
+        out[3] = (std::uint8_t) (exponent + 128);
+    }
+
+    /**
+     * @brief writeHDR - writes a frame as an (uncompressed) Radiance .hdr file, keeping its full dynamic range
+     * @param path - the file to write
+     * @param frame - the frame to write
+     * @return whether the file was written successfully
+     */
+    bool writeHDR(const std::string &path, const FrameBuffer &frame) {
+        std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(frame.height)
+                + " +X " + std::to_string(frame.width) + "\n";
+
+        // build the whole file in memory so it goes to disk in a single write
+        std::vector<std::uint8_t> bytes(header.begin(), header.end());
+        std::size_t offset = bytes.size();
+        bytes.resize(offset + 4 * std::size_t(frame.size()));
+
+        for (int i = 0; i < frame.size(); i++) {
+            toRGBE(frame.pixels[i], &bytes[offset + 4 * i]);
+        }
+
+        return writeFile(path, bytes);
+    }
+
+    /**
+     * @brief writePFM - writes the RGB channels of a frame as a color Portable Float Map
+     * @param path - the file to write
+     * @param frame - the frame to write
+     * @return whether the file was written successfully
+     */
+    bool writePFM(const std::string &path, const FrameBuffer &frame) {
+        std::vector<float> rgb(3 * std::size_t(frame.size()));
+        for (int i = 0; i < frame.size(); i++) {
+            rgb[3 * i + 0] = frame.pixels[i].r;
+            rgb[3 * i + 1] = frame.pixels[i].g;
+            rgb[3 * i + 2] = frame.pixels[i].b;
+        }
+
+        return writePFM(path, rgb.data(), frame.width, frame.height, 3);
+    }
+
+    /**
+     * @brief writePFM - writes raw floats as a Portable Float Map, which keeps negative values and doesn't quantize
+     * @param path - the file to write
+     * @param data - width * height pixels of components floats each, starting at the top row
+     * @param width - the width of the image
+     * @param height - the height of the image
+     * @param components - 1 for a grayscale map or 3 for a color map
+     * @return whether the file was written successfully
+     */
+    bool writePFM(const std::string &path, const float *data, int width, int height, int components) {
+        // a negative scale marks the data as little-endian, which is what every platform we build on uses
+        std::string header = std::string(components == 3 ? "PF" : "Pf") + "\n" + std::to_string(width) + " "
+                + std::to_string(height) + "\n-1.0\n";
+
+        std::vector<std::uint8_t> bytes(header.begin(), header.end());
+        std::size_t offset = bytes.size();
+        std::size_t rowBytes = sizeof(float) * components * width;
+        bytes.resize(offset + rowBytes * height);
+
+        // PFM stores rows from the bottom of the image up
+        for (int row = 0; row < height; row++) {
+            const float *src = data + std::size_t(height - 1 - row) * components * width;
+            std::memcpy(&bytes[offset + row * rowBytes], src, rowBytes);
+        }
+
+        return writeFile(path, bytes);
+    }
+
+    /**
+     * @brief appendEXRHeader - appends the header and line offset table of an uncompressed OpenEXR file with 32-bit
+     * float R, G and B channels. Since nothing is compressed, every scanline's offset is known up front.
+     * @param bytes - where to append the header
+     * @param width - the width of the image
+     * @param height - the height of the image
+     */
+    void appendEXRHeader(std::vector<std::uint8_t> &bytes, int width, int height) {
+        // magic number, then version 2 with no flags (a single-part scanline file)
+        bytes.insert(bytes.end(), { 0x76, 0x2f, 0x31, 0x01, 0x02, 0x00, 0x00, 0x00 });
+
+        auto putAttribute = [&](const std::string &name, const std::string &type, std::uint32_t size) {
+            bytes.insert(bytes.end(), name.begin(), name.end());
+            bytes.push_back(0);
+            bytes.insert(bytes.end(), type.begin(), type.end());
+            bytes.push_back(0);
+            putInt(bytes, size);
+        };
+
+        // channels have to be listed (and stored) in alphabetical order
+        const char *channelNames[3] = { "B", "G", "R" };
+        putAttribute("channels", "chlist", 3 * 18 + 1);
+        for (const char *channel : channelNames) {
+            bytes.push_back(channel[0]);
+            bytes.push_back(0);
+            putInt(bytes, 2);                              // FLOAT
+            bytes.insert(bytes.end(), { 0, 0, 0, 0 });     // pLinear and reserved
+            putInt(bytes, 1);                              // x sampling
+            putInt(bytes, 1);                              // y sampling
+        }
+        bytes.push_back(0);
+
+        putAttribute("compression", "compression", 1);
+        bytes.push_back(0);                                // NO_COMPRESSION
+
+        for (const char *window : { "dataWindow", "displayWindow" }) {
+            putAttribute(window, "box2i", 16);
+            putInt(bytes, 0);
+            putInt(bytes, 0);
+            putInt(bytes, width - 1);
+            putInt(bytes, height - 1);
+        }
+
+        putAttribute("lineOrder", "lineOrder", 1);
+        bytes.push_back(0);                                // INCREASING_Y
+
+        putAttribute("pixelAspectRatio", "float", 4);
+        putFloat(bytes, 1.f);
+
+        putAttribute("screenWindowCenter", "v2f", 8);
+        putFloat(bytes, 0.f);
+        putFloat(bytes, 0.f);
+
+        putAttribute("screenWindowWidth", "float", 4);
+        putFloat(bytes, 1.f);
+
+        bytes.push_back(0);                                // end of header
+
+        // the offset table points at each scanline's chunk, which is its y, its size, then each channel's row
+        const std::uint64_t chunkBytes = 8 + 3 * sizeof(float) * std::uint64_t(width);
+        const std::uint64_t firstChunk = bytes.size() + 8 * std::uint64_t(height);
+
+        for (int row = 0; row < height; row++) {
+            std::uint64_t chunkOffset = firstChunk + row * chunkBytes;
+            putInt(bytes, std::uint32_t(chunkOffset));
+            putInt(bytes, std::uint32_t(chunkOffset >> 32));
+        }
+    }
+
+    /**
+     * @brief appendEXRRows - appends the scanline chunks of some rows of an image started with appendEXRHeader
+     * @param bytes - where to append the rows
+     * @param pixels - rowCount rows of width pixels each
+     * @param width - the width of the image
+     * @param firstRow - the row of the image that the first of the pixels are in
+     * @param rowCount - the number of rows to append
+     */
+    void appendEXRRows(std::vector<std::uint8_t> &bytes, const glm::vec4 *pixels, int width, int firstRow, int rowCount) {
+        const std::uint32_t rowBytes = 3 * sizeof(float) * width;
+        bytes.reserve(bytes.size() + (8 + std::size_t(rowBytes)) * rowCount);
+
+        for (int row = 0; row < rowCount; row++) {
+            putInt(bytes, firstRow + row);
+            putInt(bytes, rowBytes);
+
+            const glm::vec4 *rowPixels = pixels + std::size_t(row) * width;
+            for (int channel = 2; channel >= 0; channel--) {
+                for (int col = 0; col < width; col++) {
+                    putFloat(bytes, rowPixels[col][channel]);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief writeEXR - writes a frame as an uncompressed OpenEXR file with 32-bit float R, G and B channels
+     * @param path - the file to write
+     * @param frame - the frame to write
+     * @return whether the file was written successfully
+     */
+    bool writeEXR(const std::string &path, const FrameBuffer &frame) {
+        std::vector<std::uint8_t> bytes;
+        appendEXRHeader(bytes, frame.width, frame.height);
+        appendEXRRows(bytes, frame.data(), frame.width, 0, frame.height);
+
+        return writeFile(path, bytes);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "utils/framebuffer.h"
+#include "utils/rgba.h"
+
+// Writers for output formats that Qt's image plugins don't cover. Each one builds the whole file in memory and hands
+// it to the OS in a single write.
+namespace ImageWriter {
+    // 8-bit formats, for frames that have already been tone mapped
+    bool writeRaw(const std::string &path, const RGBA *pixels, int width, int height);
+    bool writePPM(const std::string &path, const RGBA *pixels, int width, int height);
+    bool writeQOI(const std::string &path, const RGBA *pixels, int width, int height);
+
+    // Floating-point formats, which keep the frame's full range
+    bool writeHDR(const std::string &path, const FrameBuffer &frame);
+    bool writePFM(const std::string &path, const FrameBuffer &frame);
+    bool writePFM(const std::string &path, const float *data, int width, int height, int components);
+    bool writeEXR(const std::string &path, const FrameBuffer &frame);
+
+    // The running state of a QOI encoder, so that an image can be encoded a few rows at a time
+    class QOIEncoder {
+    public:
+        QOIEncoder();
+
+        static void appendHeader(std::vector<std::uint8_t> &bytes, int width, int height);
+        void append(std::vector<std::uint8_t> &bytes, const RGBA *pixels, std::size_t count);
+        void finish(std::vector<std::uint8_t> &bytes);
+
+    private:
+        RGBA m_seen[64];
+        RGBA m_previous;
+        int m_run = 0;
+    };
+
+    // The pieces of an uncompressed scanline EXR, which can be produced a band of rows at a time
+    void appendEXRHeader(std::vector<std::uint8_t> &bytes, int width, int height);
+    void appendEXRRows(std::vector<std::uint8_t> &bytes, const glm::vec4 *pixels, int width, int firstRow, int rowCount);
+}
@@ -0,0 +1,103 @@
+#include "rendermanifest.h"
+#include "atomicfile.h"
+
+#include <charconv>
+#include <cinttypes>
+#include <fstream>
+#include <sstream>
+
+const char *RenderManifest::HEADER = "# skippy render manifest: frame key file";
+
+RenderManifest::RenderManifest(std::FILE *file) :
+    m_file(file)
+{}
+
+RenderManifest::~RenderManifest() {
+    if (m_file != nullptr) {
+        std::fclose(m_file);
+    }
+}
+
+/**
+ * @brief RenderManifest::open - opens a manifest for appending, reading back the frames already in it if resuming
+ * @param path - where the manifest lives
+ * @param resume - whether to keep the frames recorded by earlier runs
+ * @return the manifest, or null if it can't be written
+ */
+std::unique_ptr<RenderManifest> RenderManifest::open(const std::string &path, bool resume) {
+    std::map<int, std::tuple<std::uint64_t, std::string>> finished;
+    if (resume) {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            // a crash can cut the last line short, or a damaged disk garble it, and either way it fails to parse and
+            // is ignored
+            std::istringstream fields(line);
+            int frame;
+            std::string key;
+            std::string file;
+            if (!(fields >> frame >> key >> file) || key.size() != 16) {
+                continue;
+            }
+
+            std::uint64_t value;
+            const auto [end, error] = std::from_chars(key.data(), key.data() + key.size(), value, 16);
+            if (error == std::errc() && end == key.data() + key.size()) {
+                finished[frame] = { value, file };
+            }
+        }
+    }
+
+    // rewrite what was kept, which also drops any partial line left by a crash, without ever losing the old manifest
+    bool written = AtomicFile::write(path, [&](const std::string &partial) {
+        std::FILE *out = std::fopen(partial.c_str(), "w");
+        if (out == nullptr) {
+            return false;
+        }
+
+        std::fprintf(out, "%s\n", HEADER);
+        for (auto& [ frame, entry ] : finished) {
+            auto& [ key, file ] = entry;
+            std::fprintf(out, "%d %016" PRIx64 " %s\n", frame, key, file.c_str());
+        }
+        return std::fclose(out) == 0;
+    });
+
+    std::FILE *file = written ? std::fopen(path.c_str(), "a") : nullptr;
+    if (file == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr<RenderManifest> manifest(new RenderManifest(file));
+    manifest->m_finished = std::move(finished);
+    return manifest;
+}
+
+bool RenderManifest::isFinished(int frame, std::uint64_t key) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_finished.find(frame);
+    return entry != m_finished.end() && std::get<0>(entry->second) == key;
+}
+
+/**
+ * @brief RenderManifest::add - records a frame whose files are completely written, flushing it straight away
+ * @param frame - the frame number
+ * @param key - identifies the frame's inputs, so a later run can tell whether the file is still current
+ * @param file - the frame's file name, for anyone reading the manifest
+ * @return whether the record was written
+ */
+bool RenderManifest::add(int frame, std::uint64_t key, const std::string &file) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished[frame] = { key, file };
+    std::fprintf(m_file, "%d %016" PRIx64 " %s\n", frame, key, file.c_str());
+    return std::fflush(m_file) == 0;
+}
+
+int RenderManifest::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return int(m_finished.size());
+}
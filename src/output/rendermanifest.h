@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+// An append-only record of the frames a render has finished writing, kept next to the frames. Each line is flushed as
+// soon as its frame is on disk, so after a crash the manifest lists exactly the frames that don't need rendering again.
+class RenderManifest {
+public:
+    // Opens the manifest at path. When resuming, the frames recorded by earlier runs are kept; otherwise the manifest
+    // starts out empty.
+    // @return The manifest, or null if it can't be written.
+    static std::unique_ptr<RenderManifest> open(const std::string &path, bool resume);
+
+    ~RenderManifest();
+
+    // Whether an earlier run finished the frame from inputs with the same key
+    bool isFinished(int frame, std::uint64_t key) const;
+
+    // Records a finished frame. Safe to call from several threads at once.
+    bool add(int frame, std::uint64_t key, const std::string &file);
+
+    // The number of frames recorded
+    int size() const;
+
+private:
+    RenderManifest(std::FILE *file);
+
+    static const char *HEADER;
+
+    std::FILE *m_file;
+    mutable std::mutex m_mutex;
+    std::map<int, std::tuple<std::uint64_t, std::string>> m_finished; // The key and file name of each frame
+};
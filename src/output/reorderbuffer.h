@@ -0,0 +1,53 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Puts frames that finish out of order back in order. Frames are pushed from any thread as they become ready, and
+// the sink is called with each one exactly when every frame before it (in the expected order) has been passed on.
+template <typename T>
+class ReorderBuffer {
+public:
+    using Sink = std::function<void(int frame, T &&value)>;
+
+    // @param order The frame numbers to expect, in the order the sink should see them
+    // @param sink Called with each frame in order. Calls never overlap.
+    ReorderBuffer(std::vector<int> order, Sink sink) :
+        m_order(std::move(order)),
+        m_sink(std::move(sink))
+    {}
+
+    // Hands over a finished frame, passing it (and any frames waiting on it) on to the sink if it's next in line
+    void push(int frame, T value) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_waiting.emplace(frame, std::move(value));
+
+        while (m_next < m_order.size()) {
+            auto it = m_waiting.find(m_order[m_next]);
+            if (it == m_waiting.end()) {
+                break;
+            }
+
+            m_sink(it->first, std::move(it->second));
+            m_waiting.erase(it);
+            m_next++;
+        }
+    }
+
+    // The number of frames held back waiting for an earlier frame
+    std::size_t pending() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_waiting.size();
+    }
+
+private:
+    const std::vector<int> m_order;
+    const Sink m_sink;
+
+    mutable std::mutex m_mutex;
+    std::map<int, T> m_waiting;
+    std::size_t m_next = 0;
+};
@@ -0,0 +1,187 @@
+#include "scanlinewriter.h"
+
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#define fseeko _fseeki64
+#endif
+
+ScanlineWriter::ScanlineWriter(std::FILE *file, int width, int height, Format format) :
+    m_file(file),
+    m_width(width),
+    m_height(height),
+    m_format(format)
+{}
+
+ScanlineWriter::~ScanlineWriter() {
+    close();
+}
+
+/**
+ * @brief ScanlineWriter::parseFormat - looks up a format by the name used for it in config files
+ * @param name - one of "ppm", "raw", "qoi", "pfm" or "exr"
+ * @param format - set to the matching format on success
+ * @return whether the format supports being written a band at a time
+ */
+bool ScanlineWriter::parseFormat(const std::string &name, Format &format) {
+    if (name == "ppm") {
+        format = Format::PPM;
+    } else if (name == "raw") {
+        format = Format::RAW;
+    } else if (name == "qoi") {
+        format = Format::QOI;
+    } else if (name == "pfm") {
+        format = Format::PFM;
+    } else if (name == "exr") {
+        format = Format::EXR;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+bool ScanlineWriter::isFloat(Format format) {
+    return format == Format::PFM || format == Format::EXR;
+}
+
+/**
+ * @brief ScanlineWriter::open - create a file and write its header
+ * @param path - the file to write
+ * @param width - the width of the image
+ * @param height - the height of the image
+ * @param format - the format to write
+ * @return the writer, or null if the file couldn't be created
+ */
+std::unique_ptr<ScanlineWriter> ScanlineWriter::open(const std::string &path, int width, int height, Format format) {
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr<ScanlineWriter> writer(new ScanlineWriter(file, width, height, format));
+
+    std::string header;
+    std::vector<std::uint8_t> bytes;
+    switch (format) {
+        case Format::PPM:
+            header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+            break;
+        case Format::PFM:
+            header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n-1.0\n";
+            break;
+        case Format::QOI:
+            ImageWriter::QOIEncoder::appendHeader(bytes, width, height);
+            break;
+        case Format::EXR:
+            ImageWriter::appendEXRHeader(bytes, width, height);
+            break;
+        case Format::RAW:
+            break;
+    }
+    bytes.insert(bytes.begin(), header.begin(), header.end());
+
+    if (!writer->writeBytes(bytes)) {
+        return nullptr;
+    }
+    writer->m_dataStart = std::int64_t(bytes.size());
+
+    return writer;
+}
+
+/**
+ * @brief ScanlineWriter::writeRows - appends the next rows of an 8-bit image
+ * @param pixels - rowCount rows of width pixels each
+ * @param rowCount - the number of rows
+ * @return whether the rows were written
+ */
+bool ScanlineWriter::writeRows(const RGBA *pixels, int rowCount) {
+    if (m_file == nullptr || isFloat(m_format) || m_nextRow + rowCount > m_height) {
+        return false;
+    }
+
+    const std::size_t count = std::size_t(m_width) * rowCount;
+    std::vector<std::uint8_t> bytes;
+
+    if (m_format == Format::QOI) {
+        m_qoi.append(bytes, pixels, count);
+    } else {
+        bytes.resize(3 * count);
+        for (std::size_t i = 0; i < count; i++) {
+            bytes[3 * i + 0] = pixels[i].r;
+            bytes[3 * i + 1] = pixels[i].g;
+            bytes[3 * i + 2] = pixels[i].b;
+        }
+    }
+
+    m_nextRow += rowCount;
+    return writeBytes(bytes);
+}
+
+/**
+ * @brief ScanlineWriter::writeRows - appends the next rows of a floating-point image
+ * @param pixels - rowCount rows of width pixels each
+ * @param rowCount - the number of rows
+ * @return whether the rows were written
+ */
+bool ScanlineWriter::writeRows(const glm::vec4 *pixels, int rowCount) {
+    if (m_file == nullptr || !isFloat(m_format) || m_nextRow + rowCount > m_height) {
+        return false;
+    }
+
+    std::vector<std::uint8_t> bytes;
+
+    if (m_format == Format::EXR) {
+        ImageWriter::appendEXRRows(bytes, pixels, m_width, m_nextRow, rowCount);
+        m_nextRow += rowCount;
+        return writeBytes(bytes);
+    }
+
+    // PFM stores rows from the bottom up, so this band goes just before the bands above it, which are written later
+    const std::size_t rowBytes = 3 * sizeof(float) * m_width;
+    bytes.resize(rowBytes * rowCount);
+
+    for (int row = 0; row < rowCount; row++) {
+        std::uint8_t *dst = bytes.data() + (rowCount - 1 - row) * rowBytes;
+        const glm::vec4 *src = pixels + std::size_t(row) * m_width;
+
+        for (int col = 0; col < m_width; col++) {
+            std::memcpy(dst + 12 * col, &src[col], 3 * sizeof(float));
+        }
+    }
+
+    const std::int64_t offset = m_dataStart + std::int64_t(rowBytes) * (m_height - m_nextRow - rowCount);
+    m_nextRow += rowCount;
+
+    // fseek takes a long, which is only 32 bits on Windows
+    if (fseeko(m_file, offset, SEEK_SET) != 0) {
+        m_ok = false;
+    }
+    return writeBytes(bytes);
+}
+
+/**
+ * @brief ScanlineWriter::close - finish and close the file. Safe to call more than once.
+ * @return whether every row of the image was written
+ */
+bool ScanlineWriter::close() {
+    if (m_file == nullptr) {
+        return m_ok;
+    }
+
+    if (m_format == Format::QOI) {
+        std::vector<std::uint8_t> bytes;
+        m_qoi.finish(bytes);
+        writeBytes(bytes);
+    }
+
+    m_ok = (std::fclose(m_file) == 0) && m_ok && m_nextRow == m_height;
+    m_file = nullptr;
+    return m_ok;
+}
+
+bool ScanlineWriter::writeBytes(const std::vector<std::uint8_t> &bytes) {
+    m_ok = m_ok && std::fwrite(bytes.data(), 1, bytes.size(), m_file) == bytes.size();
+    return m_ok;
+}
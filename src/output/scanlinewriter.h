@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <glm/glm.hpp>
+#include "utils/rgba.h"
+#include "output/imagewriter.h"
+
+// Writes an image a band of rows at a time, from the top down, so that the whole image never has to be in memory.
+// Only formats that can be written in order (or, for PFM, whose layout is known up front) are supported.
+class ScanlineWriter {
+public:
+    enum class Format {
+        PPM, // 8-bit binary Portable Pixmap
+        RAW, // 8-bit RGB with no header
+        QOI, // 8-bit lossless "Quite OK Image"
+        PFM, // 32-bit float Portable Float Map
+        EXR  // 32-bit float uncompressed OpenEXR
+    };
+
+    // Looks up a format by the name used for it in config files
+    static bool parseFormat(const std::string &name, Format &format);
+
+    // Whether the format takes floating-point rows (instead of tone mapped 8-bit ones)
+    static bool isFloat(Format format);
+
+    static std::unique_ptr<ScanlineWriter> open(const std::string &path, int width, int height, Format format);
+
+    ~ScanlineWriter();
+
+    // Appends the next rows of an 8-bit format. Each call is a single write.
+    bool writeRows(const RGBA *pixels, int rowCount);
+
+    // Appends the next rows of a floating-point format. Each call is a single write.
+    bool writeRows(const glm::vec4 *pixels, int rowCount);
+
+    // Finishes the file.
+    // @return Whether every row was written.
+    bool close();
+
+private:
+    ScanlineWriter(std::FILE *file, int width, int height, Format format);
+
+    bool writeBytes(const std::vector<std::uint8_t> &bytes);
+
+    std::FILE *m_file;
+    const int m_width;
+    const int m_height;
+    const Format m_format;
+    bool m_ok = true;
+
+    int m_nextRow = 0;
+    std::int64_t m_dataStart = 0; // 64-bit, as float images past 2 GiB are what banded output is for
+    ImageWriter::QOIEncoder m_qoi;
+};
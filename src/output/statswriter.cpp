@@ -0,0 +1,58 @@
+#include "statswriter.h"
+#include "atomicfile.h"
+
+StatsWriter::StatsWriter(std::FILE *jsonLines, const std::string &prometheusPath) :
+    m_jsonLines(jsonLines),
+    m_prometheusPath(prometheusPath)
+{}
+
+StatsWriter::~StatsWriter() {
+    if (m_jsonLines != nullptr) {
+        std::fclose(m_jsonLines);
+    }
+}
+
+/**
+ * @brief StatsWriter::open - opens the stats outputs
+ * @param jsonLinesPath - where to append a line per frame, or empty for none
+ * @param prometheusPath - where to keep the run's totals, or empty for none
+ * @return the writer, or null if the JSON-lines file can't be opened
+ */
+std::unique_ptr<StatsWriter> StatsWriter::open(const std::string &jsonLinesPath, const std::string &prometheusPath) {
+    std::FILE *jsonLines = nullptr;
+    if (!jsonLinesPath.empty() && (jsonLines = std::fopen(jsonLinesPath.c_str(), "a")) == nullptr) {
+        return nullptr;
+    }
+    return std::unique_ptr<StatsWriter>(new StatsWriter(jsonLines, prometheusPath));
+}
+
+/**
+ * @brief StatsWriter::write - appends a frame's stats to the JSON-lines file and rewrites the Prometheus totals
+ * @param frame - the frame's number
+ * @param stats - what rendering it took
+ * @return whether both outputs were written
+ */
+bool StatsWriter::write(int frame, const Stats::Frame &stats) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_totals += stats;
+    m_frames++;
+
+    bool success = true;
+    if (m_jsonLines != nullptr) {
+        success = std::fprintf(m_jsonLines, "%s\n", Stats::toJsonLine(frame, stats).c_str()) >= 0
+                && std::fflush(m_jsonLines) == 0;
+    }
+
+    if (!m_prometheusPath.empty()) {
+        const std::string text = Stats::toPrometheus(m_totals, m_frames);
+        success = AtomicFile::write(m_prometheusPath, [&](const std::string &partial) {
+            std::FILE *out = std::fopen(partial.c_str(), "w");
+            if (out == nullptr) {
+                return false;
+            }
+            std::fputs(text.c_str(), out);
+            return std::fclose(out) == 0;
+        }) && success;
+    }
+    return success;
+}
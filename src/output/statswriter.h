@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "utils/stats.h"
+
+// Writes the stats of each rendered frame as they come in: a line of JSON per frame, and the totals so far as a
+// Prometheus textfile that's replaced after every frame, so a scrape always sees a whole file.
+class StatsWriter {
+public:
+    // Either path may be empty to skip that output. Lines are appended to the JSON-lines file, so runs over different
+    // frames (shards, workers, resumed renders) can share one.
+    // @return The writer, or null if the JSON-lines file can't be opened.
+    static std::unique_ptr<StatsWriter> open(const std::string &jsonLinesPath, const std::string &prometheusPath);
+
+    ~StatsWriter();
+
+    // Records a frame's stats. Safe to call from several threads at once.
+    bool write(int frame, const Stats::Frame &stats);
+
+private:
+    StatsWriter(std::FILE *jsonLines, const std::string &prometheusPath);
+
+    std::FILE *m_jsonLines;
+    const std::string m_prometheusPath;
+    std::mutex m_mutex;
+    Stats::Frame m_totals;
+    int m_frames = 0;
+};
@@ -0,0 +1,196 @@
+#include "videostream.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+/**
+ * @brief toYUV - converts an 8-bit RGB pixel into BT.601 limited-range YUV, which is what encoders assume
+ * for a y4m stream that doesn't say otherwise
+ */
+static void toYUV(const RGBA &pixel, float &y, float &u, float &v) {
+    float r = pixel.r / 255.f;
+    float g = pixel.g / 255.f;
+    float b = pixel.b / 255.f;
+
+    y = 16.f + 219.f * (0.299f * r + 0.587f * g + 0.114f * b);
+    u = 128.f + 224.f * (-0.168736f * r - 0.331264f * g + 0.5f * b);
+    v = 128.f + 224.f * (0.5f * r - 0.418688f * g - 0.081312f * b);
+}
+
+static std::uint8_t toByte(float f) {
+    return (std::uint8_t) std::clamp(std::lround(f), 0L, 255L);
+}
+
+VideoStream::VideoStream(std::FILE *file, bool isPipe, int width, int height, int framerate, Chroma chroma) :
+    m_file(file),
+    m_isPipe(isPipe),
+    m_width(width),
+    m_height(height),
+    m_framerate(framerate),
+    m_chroma(chroma)
+{}
+
+VideoStream::~VideoStream() {
+    close();
+}
+
+/**
+ * @brief VideoStream::openFile - open a y4m stream to a file
+ * @param path - the file to write, or "-" to write to stdout
+ * @param width - the width of every frame
+ * @param height - the height of every frame
+ * @param framerate - the frames per second of the video
+ * @param chroma - the chroma subsampling to use
+ * @return the stream, or null if the file couldn't be opened
+ */
+std::unique_ptr<VideoStream> VideoStream::openFile(const std::string &path, int width, int height, int framerate, Chroma chroma) {
+    std::FILE *file = path == "-" ? stdout : std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr<VideoStream> stream(new VideoStream(file, false, width, height, framerate, chroma));
+    if (!stream->writeHeader()) {
+        return nullptr;
+    }
+
+    return stream;
+}
+
+/**
+ * @brief VideoStream::openEncoder - start an encoder and open a y4m stream to its stdin
+ * @param command - the shell command to run, which should read a y4m stream from stdin
+ * @param width - the width of every frame
+ * @param height - the height of every frame
+ * @param framerate - the frames per second of the video
+ * @param chroma - the chroma subsampling to use
+ * @return the stream, or null if the encoder couldn't be started
+ */
+std::unique_ptr<VideoStream> VideoStream::openEncoder(const std::string &command, int width, int height, int framerate, Chroma chroma) {
+#ifdef _WIN32
+    std::FILE *pipe = popen(command.c_str(), "wb");
+#else
+    std::FILE *pipe = popen(command.c_str(), "w");
+#endif
+    if (pipe == nullptr) {
+        return nullptr;
+    }
+
+    std::unique_ptr<VideoStream> stream(new VideoStream(pipe, true, width, height, framerate, chroma));
+    if (!stream->writeHeader()) {
+        return nullptr;
+    }
+
+    return stream;
+}
+
+/**
+ * @brief VideoStream::writeHeader - write the stream header, which describes every frame that follows
+ */
+bool VideoStream::writeHeader() {
+    std::string header = "YUV4MPEG2 W" + std::to_string(m_width) + " H" + std::to_string(m_height)
+            + " F" + std::to_string(m_framerate) + ":1 Ip A1:1 "
+            + (m_chroma == Chroma::C444 ? "C444" : "C420jpeg") + "\n";
+
+    m_ok = std::fwrite(header.data(), 1, header.size(), m_file) == header.size();
+    return m_ok;
+}
+
+/**
+ * @brief VideoStream::convert - convert a frame into a y4m frame (including its FRAME marker) in planar YUV
+ * @param pixels - the frame, width * height pixels starting from the top row
+ * @return the bytes of the converted frame, ready to be passed to write()
+ */
+std::vector<std::uint8_t> VideoStream::convert(const RGBA *pixels) const {
+    static const std::string marker = "FRAME\n";
+
+    const int chromaWidth = m_chroma == Chroma::C444 ? m_width : (m_width + 1) / 2;
+    const int chromaHeight = m_chroma == Chroma::C444 ? m_height : (m_height + 1) / 2;
+    const std::size_t lumaSize = std::size_t(m_width) * m_height;
+    const std::size_t chromaSize = std::size_t(chromaWidth) * chromaHeight;
+
+    std::vector<std::uint8_t> frame(marker.size() + lumaSize + 2 * chromaSize);
+    std::copy(marker.begin(), marker.end(), frame.begin());
+
+    std::uint8_t *yPlane = frame.data() + marker.size();
+    std::uint8_t *uPlane = yPlane + lumaSize;
+    std::uint8_t *vPlane = uPlane + chromaSize;
+
+    if (m_chroma == Chroma::C444) {
+        for (std::size_t i = 0; i < lumaSize; i++) {
+            float y, u, v;
+            toYUV(pixels[i], y, u, v);
+
+            yPlane[i] = toByte(y);
+            uPlane[i] = toByte(u);
+            vPlane[i] = toByte(v);
+        }
+
+        return frame;
+    }
+
+    // each chroma sample averages the (up to) 2x2 block of pixels it covers
+    for (int chromaRow = 0; chromaRow < chromaHeight; chromaRow++) {
+        for (int chromaCol = 0; chromaCol < chromaWidth; chromaCol++) {
+            float uSum = 0.f;
+            float vSum = 0.f;
+            int count = 0;
+
+            for (int row = 2 * chromaRow; row < std::min(2 * chromaRow + 2, m_height); row++) {
+                for (int col = 2 * chromaCol; col < std::min(2 * chromaCol + 2, m_width); col++) {
+                    float y, u, v;
+                    toYUV(pixels[row * m_width + col], y, u, v);
+
+                    yPlane[row * m_width + col] = toByte(y);
+                    uSum += u;
+                    vSum += v;
+                    count++;
+                }
+            }
+
+            uPlane[chromaRow * chromaWidth + chromaCol] = toByte(uSum / count);
+            vPlane[chromaRow * chromaWidth + chromaCol] = toByte(vSum / count);
+        }
+    }
+
+    return frame;
+}
+
+/**
+ * @brief VideoStream::write - append a frame produced by convert() to the stream
+ * @return whether the frame was written
+ */
+bool VideoStream::write(const std::vector<std::uint8_t> &frame) {
+    if (m_file == nullptr || !m_ok) {
+        return false;
+    }
+
+    m_ok = std::fwrite(frame.data(), 1, frame.size(), m_file) == frame.size();
+    return m_ok;
+}
+
+/**
+ * @brief VideoStream::close - flush and close the stream. Safe to call more than once.
+ * @return whether the whole stream was written and the encoder (if any) exited successfully
+ */
+bool VideoStream::close() {
+    if (m_file == nullptr) {
+        return m_ok;
+    }
+
+    if (m_isPipe) {
+        m_ok = (pclose(m_file) == 0) && m_ok;
+    } else if (m_file == stdout) {
+        m_ok = (std::fflush(m_file) == 0) && m_ok;
+    } else {
+        m_ok = (std::fclose(m_file) == 0) && m_ok;
+    }
+
+    m_file = nullptr;
+    return m_ok;
+}
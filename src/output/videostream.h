@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "utils/rgba.h"
+
+// An uncompressed YUV4MPEG2 (.y4m) video stream, written either to a file, to stdout, or straight into the stdin
+// of an encoder process such as ffmpeg. This lets frames go to the video encoder as they're rendered instead of
+// being written to disk as images and decoded again afterwards.
+class VideoStream {
+public:
+    enum class Chroma {
+        C444, // Full resolution color
+        C420  // Color at half resolution in each direction, which is what most encoders want anyway
+    };
+
+    // Opens a stream to a file, or to stdout if path is "-"
+    static std::unique_ptr<VideoStream> openFile(const std::string &path, int width, int height, int framerate, Chroma chroma);
+
+    // Starts a shell command and streams to its stdin
+    static std::unique_ptr<VideoStream> openEncoder(const std::string &command, int width, int height, int framerate, Chroma chroma);
+
+    ~VideoStream();
+
+    // Converts a frame to the stream's pixel format. Safe to call from several threads at once.
+    std::vector<std::uint8_t> convert(const RGBA *pixels) const;
+
+    // Appends a converted frame to the stream. Frames must be written in order, one at a time.
+    bool write(const std::vector<std::uint8_t> &frame);
+
+    // Ends the stream, waiting for the encoder to exit if there is one.
+    // @return Whether every frame was written and the encoder (if any) succeeded.
+    bool close();
+
+private:
+    VideoStream(std::FILE *file, bool isPipe, int width, int height, int framerate, Chroma chroma);
+
+    bool writeHeader();
+
+    std::FILE *m_file;
+    const bool m_isPipe;
+    const int m_width;
+    const int m_height;
+    const int m_framerate;
+    const Chroma m_chroma;
+    bool m_ok = true;
+};
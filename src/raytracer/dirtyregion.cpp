@@ -0,0 +1,240 @@
+#include "dirtyregion.h"
+
+#include "raytracer/raytracescene.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace DirtyRegion {
+    // How far in front of the camera a point has to be to project sensibly
+    static const float NEAR_PLANE = 1e-4f;
+
+    // Every primitive the tracer supports fits in the unit cube centered at the origin of its object space
+    static const glm::vec3 UNIT_CUBE_CORNERS[8] = {
+        { -0.5f, -0.5f, -0.5f }, { 0.5f, -0.5f, -0.5f }, { -0.5f, 0.5f, -0.5f }, { 0.5f, 0.5f, -0.5f },
+        { -0.5f, -0.5f,  0.5f }, { 0.5f, -0.5f,  0.5f }, { -0.5f, 0.5f,  0.5f }, { 0.5f, 0.5f,  0.5f }
+    };
+
+    /**
+     * @brief Projects world-space points and directions into pixel coordinates, the same way RayTracer generates
+     * its camera rays
+     */
+    class Projector {
+    public:
+        Projector(const Camera &camera, int width, int height) :
+            m_view(camera.getViewMatrix()),
+            m_V(2 * tan(camera.getHeightAngle() / 2.0)),
+            m_U(m_V * camera.getAspectRatio()),
+            m_width(width),
+            m_height(height)
+        {}
+
+        /**
+         * @brief Adds a world-space point to the bounds
+         * @return false if the point is behind the camera, in which case it can't be bounded
+         */
+        bool addPoint(const glm::vec3 &point) {
+            return addCameraSpace(glm::vec3(m_view * glm::vec4(point, 1.f)));
+        }
+
+        /**
+         * @brief Adds the point that a world-space direction vanishes to, i.e. where a ray heading off in that
+         * direction ends up on screen
+         * @return false if the direction heads back past the camera, in which case it can't be bounded
+         */
+        bool addDirection(const glm::vec3 &direction) {
+            return addCameraSpace(glm::mat3(m_view) * direction);
+        }
+
+        /**
+         * @brief The pixels covered by everything added so far, padded by a pixel to cover super-sampling jitter
+         */
+        Rect toRect() const {
+            if (m_minCol > m_maxCol) {
+                return Rect{};
+            }
+
+            auto clampTo = [](float value, int size) {
+                return int(std::clamp(value, 0.f, float(size)));
+            };
+
+            return Rect{
+                clampTo(std::floor(m_minCol) - 1, m_width),
+                clampTo(std::floor(m_minRow) - 1, m_height),
+                clampTo(std::ceil(m_maxCol) + 2, m_width),
+                clampTo(std::ceil(m_maxRow) + 2, m_height)
+            };
+        }
+
+    private:
+        bool addCameraSpace(const glm::vec3 &p) {
+            if (p.z > -NEAR_PLANE) {
+                return false;
+            }
+
+            // invert the ray generation in RayTracer::renderRows
+            float x = p.x / (-p.z * m_U);
+            float y = p.y / (-p.z * m_V);
+            float col = (x + 0.5f) * m_width - 0.5f;
+            float row = m_height - 0.5f - (y + 0.5f) * m_height;
+
+            m_minCol = std::min(m_minCol, col);
+            m_maxCol = std::max(m_maxCol, col);
+            m_minRow = std::min(m_minRow, row);
+            m_maxRow = std::max(m_maxRow, row);
+            return true;
+        }
+
+        const glm::mat4 m_view;
+        const float m_V;
+        const float m_U;
+        const int m_width;
+        const int m_height;
+
+        float m_minCol = std::numeric_limits<float>::max();
+        float m_maxCol = std::numeric_limits<float>::lowest();
+        float m_minRow = std::numeric_limits<float>::max();
+        float m_maxRow = std::numeric_limits<float>::lowest();
+    };
+
+    static bool sameCamera(const SceneCameraData &a, const SceneCameraData &b) {
+        return a.pos == b.pos && a.look == b.look && a.up == b.up && a.heightAngle == b.heightAngle
+                && a.aperture == b.aperture && a.focalLength == b.focalLength;
+    }
+
+    static bool sameGlobals(const SceneGlobalData &a, const SceneGlobalData &b) {
+        return a.ka == b.ka && a.kd == b.kd && a.ks == b.ks && a.kt == b.kt;
+    }
+
+    static bool sameLight(const SceneLightData &a, const SceneLightData &b) {
+        return a.type == b.type && a.color == b.color && a.function == b.function && a.pos == b.pos
+                && a.dir == b.dir && a.penumbra == b.penumbra && a.angle == b.angle;
+    }
+
+    static bool samePlacement(const RenderShapeData &a, const RenderShapeData &b) {
+        return a.primitive.type == b.primitive.type && a.primitive.meshfile == b.primitive.meshfile && a.ctm == b.ctm;
+    }
+
+    static bool sameShape(const RenderShapeData &a, const RenderShapeData &b) {
+        return samePlacement(a, b) && RayTraceScene::sameMaterial(a.primitive.material, b.primitive.material);
+    }
+
+    /**
+     * @brief Adds the screen-space bounds of a shape, and optionally of the shadows it casts, to the projector.
+     * A shape's shadow from a light lies inside the volume swept by pushing its bounding box away from the light
+     * forever, whose outline on screen is spanned by the box's corners and the points their shadow rays vanish to.
+     * @return false if the bounds can't be projected
+     */
+    static bool addShape(Projector &projector, const glm::mat4 &ctm, const std::vector<SceneLightData> &lights, bool shadows) {
+        glm::vec3 corners[8];
+        for (int i = 0; i < 8; i++) {
+            corners[i] = glm::vec3(ctm * glm::vec4(UNIT_CUBE_CORNERS[i], 1.f));
+            if (!projector.addPoint(corners[i])) {
+                return false;
+            }
+        }
+
+        if (!shadows) {
+            return true;
+        }
+
+        for (const SceneLightData &light : lights) {
+            if (light.type == LightType::LIGHT_DIRECTIONAL) {
+                if (!projector.addDirection(glm::vec3(light.dir))) {
+                    return false;
+                }
+                continue;
+            }
+
+            // spot lights are bounded as if they shone in every direction
+            for (const glm::vec3 &corner : corners) {
+                if (!projector.addDirection(corner - glm::vec3(light.pos))) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief between - finds the region of the image that may differ between two frames
+     * @param previous - the frame that was rendered last
+     * @param next - the frame about to be rendered
+     * @param camera - the camera of the next frame
+     * @param width - the width of the image
+     * @param height - the height of the image
+     * @param shadows - whether shadows are rendered
+     * @param reflections - whether reflections are rendered
+     * @return the region that may have changed, or nothing if the whole frame has to be rendered
+     */
+    std::optional<Rect> between(const RenderData &previous, const RenderData &next, const Camera &camera,
+                                int width, int height, bool shadows, bool reflections) {
+        // anything that affects every pixel means starting over
+        if (!sameCamera(previous.cameraData, next.cameraData) || !sameGlobals(previous.globalData, next.globalData)
+                || previous.lights.size() != next.lights.size() || previous.shapes.size() != next.shapes.size()) {
+            return std::nullopt;
+        }
+
+        for (std::size_t i = 0; i < next.lights.size(); i++) {
+            if (!sameLight(previous.lights[i], next.lights[i])) {
+                return std::nullopt;
+            }
+        }
+
+        Projector projector(camera, width, height);
+        bool changed = false;
+
+        // a changed shape affects the pixels it covered, the pixels it now covers, and the shadows of both
+        for (std::size_t i = 0; i < next.shapes.size(); i++) {
+            const RenderShapeData &before = previous.shapes[i];
+            const RenderShapeData &after = next.shapes[i];
+            if (sameShape(before, after)) {
+                continue;
+            }
+
+            changed = true;
+            if (!addShape(projector, before.ctm, next.lights, shadows) || !addShape(projector, after.ctm, next.lights, shadows)) {
+                return std::nullopt;
+            }
+        }
+
+        if (!changed) {
+            return Rect{};
+        }
+
+        // any of those changes might be seen in a mirror, so every reflective surface has to be traced again too
+        if (reflections) {
+            for (const RenderData *data : { &previous, &next }) {
+                for (const RenderShapeData &shape : data->shapes) {
+                    if (shape.primitive.material.cReflective != glm::vec4(0.f)
+                            && !addShape(projector, shape.ctm, next.lights, false)) {
+                        return std::nullopt;
+                    }
+                }
+            }
+        }
+
+        return projector.toRect();
+    }
+
+    /**
+     * @brief sameGeometry - checks whether every camera ray hits the same surface in two frames
+     * @param previous - the frame that was rendered last
+     * @param next - the frame about to be rendered
+     * @return whether the camera and every shape's placement are unchanged
+     */
+    bool sameGeometry(const RenderData &previous, const RenderData &next) {
+        if (!sameCamera(previous.cameraData, next.cameraData) || previous.shapes.size() != next.shapes.size()) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < next.shapes.size(); i++) {
+            if (!samePlacement(previous.shapes[i], next.shapes[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <optional>
+#include "camera/camera.h"
+#include "utils/sceneparser.h"
+
+// Works out which pixels can differ between two consecutive frames of an animation, so that only those need to be
+// traced again. The region is conservative: every pixel that may have changed is inside it.
+namespace DirtyRegion {
+    // A rectangle of pixels, from [left, top] up to but not including [right, bottom]
+    struct Rect {
+        int left   = 0;
+        int top    = 0;
+        int right  = 0;
+        int bottom = 0;
+
+        bool empty() const { return right <= left || bottom <= top; }
+        long area() const { return empty() ? 0 : long(right - left) * (bottom - top); }
+    };
+
+    // Finds the region of the image that may differ between two frames seen from the same camera.
+    // @param camera The camera of the next frame.
+    // @param shadows Whether shadows are rendered, which lets a moving object change pixels outside its own bounds.
+    // @param reflections Whether reflections are rendered, which lets it change pixels on any reflective object.
+    // @return The region, which is empty if nothing changed, or nothing if the change can't be bounded (e.g. the
+    // camera or a light moved) and the whole frame has to be rendered.
+    std::optional<Rect> between(const RenderData &previous, const RenderData &next, const Camera &camera,
+                                int width, int height, bool shadows, bool reflections);
+
+    // Whether two frames see the same geometry from the same camera, so every camera ray hits the same surface at the
+    // same point in both. Lights, materials and global coefficients may still differ.
+    bool sameGeometry(const RenderData &previous, const RenderData &next);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+// The primary hits of a rendered frame: for every sample of every pixel, where its camera ray went and the surface it
+// landed on. As long as the camera and geometry stay put, the same hits can be shaded again under different lights
+// without tracing any camera rays.
+struct GBuffer {
+    struct Sample {
+        glm::vec3 origin    = glm::vec3(0.f); // The camera ray, in world space
+        glm::vec3 direction = glm::vec3(0.f);
+        float     t         = 0.f;            // Distance along the ray to the hit
+        glm::vec3 normal    = glm::vec3(0.f);
+        glm::vec2 uv        = glm::vec2(0.f);
+        int       primitive = -1;             // Index into RayTraceScene::getPrims(), or -1 if the ray hit nothing
+    };
+
+    GBuffer(int width, int height, int samplesPerPixel) :
+        width(width),
+        height(height),
+        samplesPerPixel(samplesPerPixel),
+        samples(std::size_t(width) * height * samplesPerPixel)
+    {}
+
+    Sample &at(int pixel, int sample) { return samples[std::size_t(pixel) * samplesPerPixel + sample]; }
+    const Sample &at(int pixel, int sample) const { return samples[std::size_t(pixel) * samplesPerPixel + sample]; }
+
+    int width;
+    int height;
+    int samplesPerPixel;
+    std::vector<Sample> samples;
+};
@@ -0,0 +1,62 @@
+#include "incrementalrenderer.h"
+
+IncrementalRenderer::IncrementalRenderer(RayTracer::Config config, Mode mode) :
+    m_config(config),
+    m_mode(mode),
+    m_raytracer(config)
+{}
+
+bool IncrementalRenderer::supports(const RayTracer::Config &config) {
+    return !config.enableDenoise;
+}
+
+/**
+ * @brief IncrementalRenderer::render - renders the next frame, reusing whatever it can of the previous frame
+ * @param frame - the frame to fill, which must match the scene's dimensions
+ * @param scene - the scene to render
+ * @param data - the data the scene was built from, which is compared against the previous frame's
+ * @return how much of the frame was traced, and whether the rest was relit
+ */
+IncrementalRenderer::Result IncrementalRenderer::render(FrameBuffer &frame, const RayTraceScene &scene, const RenderData &data) {
+    if (!supports(m_config)) {
+        m_raytracer.render(frame, scene);
+        return Result{};
+    }
+
+    const int width = scene.width();
+    const int height = scene.height();
+    const bool hasPrevious = m_previousData != nullptr && m_previousFrame.has_value()
+            && m_previousFrame->width == width && m_previousFrame->height == height;
+
+    std::optional<DirtyRegion::Rect> region;
+    if (hasPrevious && m_mode.dirtyRegions) {
+        region = DirtyRegion::between(*m_previousData, data, scene.getCamera(), width, height,
+                                      m_config.enableShadow, m_config.enableReflection);
+    }
+
+    Result result;
+    if (region.has_value()) {
+        // start from the previous frame and trace over what changed, keeping the G-buffer up to date as we go
+        frame.pixels = m_previousFrame->pixels;
+        m_raytracer.renderRegion(frame, scene, region.value(), m_gbuffer ? &m_gbuffer.value() : nullptr);
+        result.traced = float(region->area()) / frame.size();
+    } else if (hasPrevious && m_gbuffer.has_value() && DirtyRegion::sameGeometry(*m_previousData, data)) {
+        // every camera ray would hit what it hit last time, so only the shading needs doing again
+        m_raytracer.relight(frame, scene, m_gbuffer.value());
+        result = Result{ 0.f, true };
+    } else {
+        if (m_mode.gbuffer) {
+            m_gbuffer.emplace(width, height, m_config.enableSuperSample ? m_config.numSamples : 1);
+        }
+        m_raytracer.renderRegion(frame, scene, DirtyRegion::Rect{ 0, 0, width, height },
+                                 m_gbuffer ? &m_gbuffer.value() : nullptr);
+    }
+
+    // the next frame builds on this one as it was before post-processing
+    m_previousFrame = frame;
+    m_previousData = &data;
+
+    m_raytracer.postProcess(frame, nullptr);
+
+    return result;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <optional>
+#include "raytracer.h"
+#include "gbuffer.h"
+#include "utils/framebuffer.h"
+#include "utils/sceneparser.h"
+
+// Renders the frames of an animation in order, reusing as much of the previous frame as it can. Pixels that can't
+// have changed are copied, and when only lights or materials changed, the previous frame's primary hits are shaded
+// again instead of tracing camera rays. Falls back to a full render whenever neither applies, e.g. when the camera
+// moves.
+class IncrementalRenderer {
+public:
+    struct Mode {
+        bool dirtyRegions = true;  // Only trace the pixels around objects that changed since the previous frame
+        bool gbuffer      = false; // Keep every sample's primary hit, and only re-shade them when just lighting changed
+    };
+
+    // How a frame was rendered
+    struct Result {
+        float traced = 1.f;    // The fraction of the frame's pixels whose camera rays were traced
+        bool  relit  = false;  // Whether the rest were shaded again from the G-buffer, rather than copied
+    };
+
+    IncrementalRenderer(RayTracer::Config config, Mode mode);
+
+    // Renders the next frame of the animation, including any post-processing.
+    // @param data The scene data the scene was built from; it must outlive the next call.
+    Result render(FrameBuffer &frame, const RayTraceScene &scene, const RenderData &data);
+
+    // Whether the config allows rendering incrementally at all. The denoiser blurs across the whole frame using
+    // surface features that aren't kept between frames, so it always needs a full render.
+    static bool supports(const RayTracer::Config &config);
+
+private:
+    const RayTracer::Config m_config;
+    const Mode m_mode;
+    RayTracer m_raytracer;
+
+    // The last frame rendered, before post-processing, and the data it was rendered from
+    const RenderData *m_previousData = nullptr;
+    std::optional<FrameBuffer> m_previousFrame;
+
+    // The primary hits of the last frame, if the mode keeps them
+    std::optional<GBuffer> m_gbuffer;
+};
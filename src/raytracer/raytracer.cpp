@@ -2,63 +2,174 @@
 #include "lighting/lightmodel.h"
 #include "primitives/worldprimitive.h"
 #include "filter/filter.h"
+#include "filter/tonemap.h"
+#include "texture/texture.h"
 #include "utils/colorutils.h"
 #include "raytracerhelper.h"
+#include "utils/parallel.h"
+#include "utils/stats.h"
+#include "utils/trace.h"
 
 #include <QtConcurrent>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
 
 RayTracer::RayTracer(Config config) :
     m_config(config)
 {}
 
+// The deepest reflection traced on this thread since renderRows last reset it, for the recursion AOV
+static thread_local int deepestReflection = 0;
+
 
 /**
  * @brief Given a ray and a scene, find the color vector that should be rendered
  * 
  * @param ray - Some ray in world space
  * @param scene - Data about the render scene
+ * @param depth - How many reflections deep this ray is
+ * @param surface - If not null, filled with the features of the first surface the ray hits
  * @return glm::vec4 - A 4d vector representing the RGBA of the ray's intersection color
  */
-glm::vec4 RayTracer::traceRay(const Ray &ray, const RayTraceScene &scene, const int depth) {
-    const SceneGlobalData &globalData = scene.getGlobalData();
-    std::vector<Intersection::MaterialIntersection> intersections = RayTracerHelper::getIntersections(ray, scene.getPrims());
-
-    if (!intersections.empty()) {
-        // find the closest intersection of all the primitives
-        auto& [ intersection, material ] = Intersection::getFirst(intersections);
-        auto& [ t, normal, uv ] = intersection;
-
-        const glm::vec3 pt = ray.getPoint(t);
-
-        const glm::vec4 phongLighting = phong(
-                    pt,
-                    normal,
-                    -ray.getDir(),
-                    material,
-                    uv,
-                    scene.getTextures(),
-                    scene.getLights(),
-                    scene.getGlobalData(),
-                    scene.getPrims(),
-                    m_config.enableShadow,
-                    m_config.enableTextureMap);
-
-        if (!m_config.enableReflection || glm::all(glm::equal(material.cReflective, glm::vec4(0.f))) || depth == 4) {
-            return phongLighting;
-        }
-
-        // trace a recursive reflective ray
-        glm::vec3 reflectedDir = glm::normalize(glm::reflect(ray.getDir(), normal));
-        Ray recursiveRay = Ray(pt + (0.001f * reflectedDir), reflectedDir);
-        glm::vec4 reflectedLight = scene.getGlobalData().ks * material.cReflective * traceRay(recursiveRay, scene, depth + 1);
-
-        // the total light is the light at this point + the light of the reflected ray.
-        return phongLighting + reflectedLight;
+glm::vec4 RayTracer::traceRay(const Ray &ray, const RayTraceScene &scene, const int depth, Surface *surface) {
+    // find the closest intersection of all the primitives
+    auto closest = RayTracerHelper::getClosestIntersection(ray, scene.getPrims());
+
+    if (closest.has_value()) {
+        auto& [ materialIntersection, primIndex ] = closest.value();
+        auto& [ intersection, material ] = materialIntersection;
+        return shade(ray, intersection, material, primIndex, scene, depth, surface);
      } else {
         return { 0, 0, 0, 0 };
     }
 }
 
+/**
+ * @brief Given a ray and the surface it hits, find the color of the light leaving the surface along the ray
+ *
+ * @param ray - The ray, in world space
+ * @param intersection - Where the ray hits the surface
+ * @param material - The material of the surface
+ * @param primIndex - The index of the surface's primitive in the scene
+ * @param scene - Data about the render scene
+ * @param depth - How many reflections deep this ray is
+ * @param surface - If not null, filled with the features of the surface
+ * @return glm::vec4 - A 4d vector representing the RGBA of the ray's intersection color
+ */
+glm::vec4 RayTracer::shade(const Ray &ray, const Intersection::Intersection &intersection, const SceneMaterial &material,
+                           int primIndex, const RayTraceScene &scene, const int depth, Surface *surface) {
+    const SceneGlobalData &globalData = scene.getGlobalData();
+    auto& [ t, normal, uv ] = intersection;
+
+    const glm::vec3 pt = ray.getPoint(t);
+
+    if (surface != nullptr) {
+        surface->normal = normal;
+        surface->uv = glm::vec2(std::get<0>(uv), std::get<1>(uv));
+        surface->distance = t;
+        surface->primitive = primIndex;
+        surface->material = scene.getMaterialIds()[primIndex];
+
+        // the diffuse color before lighting, blended with the texture the same way phong does
+        glm::vec4 albedo = globalData.kd * material.cDiffuse;
+        if (m_config.enableTextureMap && material.textureMap.isUsed) {
+            glm::vec4 textureColor = Texture::getPixel(uv, scene.getTextures().at(material.textureMap.filename), material);
+            albedo = ((1 - material.blend) * albedo) + (material.blend * textureColor);
+        }
+        surface->albedo = glm::vec3(albedo);
+    }
+
+    const glm::vec4 phongLighting = phong(
+                pt,
+                normal,
+                -ray.getDir(),
+                material,
+                uv,
+                scene.getTextures(),
+                scene.getLights(),
+                scene.getGlobalData(),
+                scene.getPrims(),
+                m_config.enableShadow,
+                m_config.enableTextureMap);
+
+    if (!m_config.enableReflection || glm::all(glm::equal(material.cReflective, glm::vec4(0.f))) || depth == 4) {
+        return phongLighting;
+    }
+
+    // trace a recursive reflective ray
+    SKIPPY_STAT(REFLECTION_RAYS, 1);
+    deepestReflection = std::max(deepestReflection, depth + 1);
+    glm::vec3 reflectedDir = glm::normalize(glm::reflect(ray.getDir(), normal));
+    Ray recursiveRay = Ray(pt + (0.001f * reflectedDir), reflectedDir);
+    glm::vec4 reflectedLight = scene.getGlobalData().ks * material.cReflective * traceRay(recursiveRay, scene, depth + 1);
+
+    // the total light is the light at this point + the light of the reflected ray.
+    return phongLighting + reflectedLight;
+}
+
+/**
+ * @brief Records the features of the surface under a pixel in whichever AOV channels are enabled
+ *
+ * @param aovs - the AOV buffers to write to
+ * @param index - the index of the pixel
+ * @param surface - the surface the pixel's center ray hit
+ * @param forwardCos - the cosine between the center ray and the camera's view direction, to turn distance into depth
+ */
+static void storeSurface(AOV::Buffers &aovs, int index, const RayTracer::Surface &surface, float forwardCos) {
+    if (aovs.has(AOV::DEPTH))        { aovs.depth[index] = surface.distance * forwardCos; }
+    if (aovs.has(AOV::NORMAL))       { aovs.normal[index] = surface.normal; }
+    if (aovs.has(AOV::ALBEDO))       { aovs.albedo[index] = surface.albedo; }
+    if (aovs.has(AOV::PRIMITIVE_ID)) { aovs.primitiveId[index] = surface.primitive; }
+    if (aovs.has(AOV::MATERIAL_ID))  { aovs.materialId[index] = surface.material; }
+    if (aovs.has(AOV::HIT_T))        { aovs.hitT[index] = surface.distance; }
+}
+
+/**
+ * @brief Stores what a pixel cost to trace in whichever of the cost channels are enabled
+ *
+ * @param aovs - the buffers to store into
+ * @param index - the pixel's index in the buffers
+ * @param intersectionTests - the intersection tests counted by this thread before the pixel was started
+ * @param shadowRays - the shadow rays counted by this thread before the pixel was started
+ */
+static void storeCosts(AOV::Buffers &aovs, int index, std::uint64_t intersectionTests, std::uint64_t shadowRays) {
+    if (aovs.has(AOV::INTERSECTIONS)) {
+        aovs.intersections[index] = Stats::threadCount(Stats::INTERSECTION_TESTS) - intersectionTests;
+    }
+    if (aovs.has(AOV::SHADOW_RAYS)) {
+        aovs.shadowRays[index] = Stats::threadCount(Stats::SHADOW_RAYS) - shadowRays;
+    }
+    if (aovs.has(AOV::RECURSION)) {
+        aovs.recursion[index] = deepestReflection;
+    }
+}
+
+/**
+ * @brief Picks a sub-pixel offset for a super-sample from nothing but where it is, so the same sample always lands
+ * in the same place however the rows are split up or scheduled across threads
+ *
+ * @param row - the row of the pixel in the scene
+ * @param col - the column of the pixel
+ * @param sampleNum - which of the pixel's samples this is
+ * @param axis - 0 for the horizontal offset, 1 for the vertical one
+ * @return an offset in [0, 1)
+ */
+static float deterministicOffset(int row, int col, int sampleNum, int axis) {
+    // a few rounds of an integer hash (lowbias32) over the sample's coordinates
+    std::uint32_t h = std::uint32_t(row) * 0x9e3779b9u ^ std::uint32_t(col) * 0x85ebca6bu
+            ^ std::uint32_t(sampleNum * 2 + axis) * 0xc2b2ae35u;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+
+    // the top 24 bits fit a float exactly
+    return float(h >> 8) / float(1u << 24);
+}
+
 /**
  * @brief Given a pointer to an image and a scene, it renders the scene into the image
  * 
@@ -66,6 +177,182 @@ glm::vec4 RayTracer::traceRay(const Ray &ray, const RayTraceScene &scene, const
  * @param scene - A reference to a RayTraceScene
  */
 void RayTracer::render(RGBA *imageData, const RayTraceScene &scene) {
+    FrameBuffer frame(scene.width(), scene.height());
+    render(frame, scene);
+
+    // clamp and quantize, the way pixels were converted before frames were kept in floating-point
+    ToneMap::apply(frame, imageData, ToneMap::Config{}, m_config.enableParallelism);
+}
+
+/**
+ * @brief Given a floating-point frame and a scene, it renders the scene into the frame
+ *
+ * @param frame - the frame to fill with linear radiance
+ * @param scene - A reference to a RayTraceScene
+ * @param aovs - If not null, the enabled channels are filled in alongside the frame
+ */
+void RayTracer::render(FrameBuffer &frame, const RayTraceScene &scene, AOV::Buffers *aovs) {
+    // the denoiser needs some surface features even if the caller didn't ask for any
+    std::optional<AOV::Buffers> ownAovs;
+    if (m_config.enableDenoise) {
+        if (aovs == nullptr) {
+            aovs = &ownAovs.emplace(frame.width, frame.height, 0);
+        }
+        aovs->enable(AOV::DENOISER_GUIDES);
+    }
+
+    renderRows(frame, scene, 0, aovs);
+    postProcess(frame, aovs);
+}
+
+/**
+ * @brief Renders the scene a band of rows at a time, handing each finished band to the sink before the next one is
+ * started, so memory use is proportional to the band height instead of the image. Each band is rendered with a halo
+ * of extra rows above and below that is wide enough to cover the reach of the post-processing filters, so the rows
+ * that are kept come out the same as they would from a whole-frame render.
+ *
+ * @param scene - A reference to a RayTraceScene
+ * @param bandHeight - the number of rows in each band (the last one may be shorter)
+ * @param sink - called with each band, top to bottom, along with the scene row it starts at
+ * @return false if the sink returned false, which stops the render
+ */
+bool RayTracer::renderBands(const RayTraceScene &scene, int bandHeight, const BandSink &sink) {
+    const int sceneWidth = scene.width();
+    const int sceneHeight = scene.height();
+    const int halo = filterHalo();
+
+    for (int rowStart = 0; rowStart < sceneHeight; rowStart += bandHeight) {
+        const int rowEnd = std::min(rowStart + bandHeight, sceneHeight);
+        const int haloStart = std::max(rowStart - halo, 0);
+        const int haloEnd = std::min(rowEnd + halo, sceneHeight);
+
+        FrameBuffer band(sceneWidth, haloEnd - haloStart);
+
+        std::optional<AOV::Buffers> guides;
+        if (m_config.enableDenoise) {
+            guides.emplace(sceneWidth, band.height, AOV::DENOISER_GUIDES);
+        }
+
+        renderRows(band, scene, haloStart, guides ? &guides.value() : nullptr);
+        postProcess(band, guides ? &guides.value() : nullptr);
+
+        // drop the halo, keeping only the rows this band is responsible for
+        band.pixels.erase(band.pixels.begin() + std::size_t(rowEnd - haloStart) * sceneWidth, band.pixels.end());
+        band.pixels.erase(band.pixels.begin(), band.pixels.begin() + std::size_t(rowStart - haloStart) * sceneWidth);
+        band.height = rowEnd - rowStart;
+
+        if (!sink(band, rowStart)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief The number of rows beyond its own that a pixel's post-processed color depends on
+ */
+int RayTracer::filterHalo() const {
+    int halo = 0;
+
+    // each a-trous pass reaches two taps out, at a spacing that doubles every pass
+    if (m_config.enableDenoise) {
+        for (int pass = 0; pass < m_config.denoiser.iterations; pass++) {
+            halo += 2 << pass;
+        }
+    }
+
+    if (m_config.enablePostProcess) {
+        halo += BLUR_RADIUS;
+    }
+
+    return halo;
+}
+
+/**
+ * @brief Denoises and blurs a rendered frame (or band of one), as enabled in the config
+ *
+ * @param frame - the rendered frame
+ * @param aovs - the surface features of the frame, which must include the denoiser's guides if it is enabled
+ */
+void RayTracer::postProcess(FrameBuffer &frame, const AOV::Buffers *aovs) {
+    Stats::PhaseTimer timer(Stats::FILTER);
+
+    // smooth out sampling noise without crossing edges in the geometry or textures
+    if (m_config.enableDenoise) {
+        Denoiser::apply(frame, *aovs, m_config.denoiser, m_config.enableParallelism);
+    }
+
+    // apply a little blur at the end if post-processing is enabled to remove some noise
+    if (m_config.enablePostProcess) {
+        Filter::applyBlur(frame.data(), frame.width, frame.height, BLUR_RADIUS, m_config.enableParallelism);
+    }
+}
+
+/**
+ * @brief Given a frame that was already rendered, it traces only the pixels inside the given region again, leaving
+ * the rest of the frame untouched. No post-processing is applied.
+ *
+ * @param frame - the frame to update, which must match the scene's dimensions
+ * @param scene - A reference to a RayTraceScene
+ * @param region - the pixels to trace
+ * @param gbuffer - If not null, the primary hits of the traced pixels are recorded in it
+ */
+void RayTracer::renderRegion(FrameBuffer &frame, const RayTraceScene &scene, const DirtyRegion::Rect &region,
+                             GBuffer *gbuffer) {
+    renderRows(frame, scene, 0, nullptr, &region, gbuffer);
+}
+
+/**
+ * @brief Given the primary hits of an earlier render, it shades them again under the scene's current lights and
+ * materials. Shadow and reflection rays are traced as usual, but no camera rays are, which is only correct as long as
+ * the camera and geometry haven't changed since the hits were recorded. No post-processing is applied.
+ *
+ * @param frame - the frame to fill, which must match the scene's dimensions
+ * @param scene - A reference to a RayTraceScene
+ * @param gbuffer - the primary hits, recorded by renderRegion with the same camera and geometry
+ */
+void RayTracer::relight(FrameBuffer &frame, const RayTraceScene &scene, const GBuffer &gbuffer) {
+    Stats::PhaseTimer timer(Stats::TRACE);
+    Trace::Span span("relight");
+    const int numSamples = gbuffer.samplesPerPixel;
+    const std::vector<const SceneMaterial *> &materials = scene.getMaterials();
+
+    Parallel::forEachBand(frame.height, m_config.enableParallelism, [&](int rowStart, int rowEnd) {
+        for (int index = rowStart * frame.width; index < rowEnd * frame.width; index++) {
+            glm::vec4 accumulator = glm::vec4{ 0.f, 0.f, 0.f, 0.f };
+            for (int sampleNum = 0; sampleNum < numSamples; sampleNum++) {
+                const GBuffer::Sample &sample = gbuffer.at(index, sampleNum);
+                if (sample.primitive < 0) {
+                    continue;
+                }
+
+                const Intersection::Intersection intersection{ sample.t, sample.normal, { sample.uv.x, sample.uv.y } };
+                accumulator += shade(Ray(sample.origin, sample.direction), intersection, *materials[sample.primitive],
+                                     sample.primitive, scene, 0, nullptr);
+            }
+
+            // take the average of all samples, the same way renderRows does
+            accumulator /= numSamples;
+            accumulator.a = 1.f;
+            frame.pixels[index] = accumulator;
+        }
+    });
+}
+
+/**
+ * @brief Given a floating-point frame that covers some rows of the scene, it traces every pixel of those rows
+ *
+ * @param frame - the frame to fill with linear radiance, as wide as the scene and as tall as the rows to render
+ * @param scene - A reference to a RayTraceScene
+ * @param firstRow - the row of the scene that the top row of the frame shows
+ * @param aovs - If not null, the enabled channels are filled in alongside the frame (and must be the frame's size)
+ * @param region - If not null, only the pixels of the frame inside it are traced
+ * @param gbuffer - If not null, the primary hit of every traced sample is recorded in it (and it must be the frame's size)
+ */
+void RayTracer::renderRows(FrameBuffer &frame, const RayTraceScene &scene, int firstRow, AOV::Buffers *aovs,
+                           const DirtyRegion::Rect *region, GBuffer *gbuffer) {
+    Stats::PhaseTimer timer(Stats::TRACE);
     int sceneWidth = scene.width();
     int sceneHeight = scene.height();
 
@@ -76,16 +363,45 @@ void RayTracer::render(RGBA *imageData, const RayTraceScene &scene) {
     // take 1 sample if not super-sampling, otherwise take the specified number of samples
     int numSamples = m_config.enableSuperSample ? m_config.numSamples: 1;
 
+    const bool timePixels = aovs != nullptr && aovs->has(AOV::TIME);
+    const bool countPixels = aovs != nullptr && (aovs->channels & (AOV::INTERSECTIONS | AOV::SHADOW_RAYS | AOV::RECURSION));
+
+    // the blocks of pixels each worker traces, for the timeline
+    Trace::TileSpans tiles("trace");
+
     auto fillIndex = [&](int index) {
-        int row = index / sceneWidth;
+        int row = firstRow + index / sceneWidth;
         int col = index % sceneWidth;
+        if (tiles.enabled()) {
+            tiles.begin(index);
+        }
+        std::chrono::steady_clock::time_point startTime;
+        if (timePixels) {
+            startTime = std::chrono::steady_clock::now();
+        }
+        std::uint64_t intersectionTests = 0, shadowRays = 0;
+        if (countPixels) {
+            intersectionTests = Stats::threadCount(Stats::INTERSECTION_TESTS);
+            shadowRays = Stats::threadCount(Stats::SHADOW_RAYS);
+            deepestReflection = 0;
+        }
 
+        SKIPPY_STAT(PRIMARY_RAYS, numSamples);
         glm::vec4 accumulator = glm::vec4{ 0.f, 0.f, 0.f, 0.f };
         for (int sampleNum = 0; sampleNum < numSamples; sampleNum++) {
             // generate a pixel offset (0 - 1) for stochastic super-sampling
             // ensure that 1 sample goes directly through the center of the pixel
-            float randXOffset = (sampleNum == numSamples - 1) ? 0.5f : ((float) (std::rand()) / (float) RAND_MAX);
-            float randYOffset = (sampleNum == numSamples - 1) ? 0.5f : ((float) (std::rand()) / (float) RAND_MAX);
+            float randXOffset = 0.5f;
+            float randYOffset = 0.5f;
+            if (sampleNum != numSamples - 1) {
+                if (m_config.deterministicSampling) {
+                    randXOffset = deterministicOffset(row, col, sampleNum, 0);
+                    randYOffset = deterministicOffset(row, col, sampleNum, 1);
+                } else {
+                    randXOffset = (float) (std::rand()) / (float) RAND_MAX;
+                    randYOffset = (float) (std::rand()) / (float) RAND_MAX;
+                }
+            }
 
             float y = (((float) (sceneHeight - 1 - row + randYOffset)) / sceneHeight) - 0.5;
             float x = (((float) col + randXOffset) / sceneWidth) - 0.5;
@@ -98,34 +414,68 @@ void RayTracer::render(RGBA *imageData, const RayTraceScene &scene) {
             Ray ray = Ray(eye, d);
             ray.transform(camera.getInverseViewMatrix());
 
-            accumulator += traceRay(ray, scene);
+            // surface features come from the sample through the center of the pixel, so they stay free of noise
+            const bool storeAovs = aovs != nullptr && sampleNum == numSamples - 1;
+            if (storeAovs || gbuffer != nullptr) {
+                Surface surface;
+                accumulator += traceRay(ray, scene, 0, &surface);
+                if (storeAovs) {
+                    storeSurface(*aovs, index, surface, -d.z);
+                }
+                if (gbuffer != nullptr) {
+                    gbuffer->at(index, sampleNum) = GBuffer::Sample{
+                        ray.getPos(), ray.getDir(), surface.distance, surface.normal, surface.uv, surface.primitive
+                    };
+                }
+            } else {
+                accumulator += traceRay(ray, scene);
+            }
         }
 
         // take the average of all samples
         accumulator /= numSamples;
+        accumulator.a = 1.f;
+
+        // store the full-precision color; quantization is left to whoever writes the frame out
+        frame.pixels[index] = accumulator;
 
-        // finally convert it to a color and add it to the image.
-        imageData[index] = ColorUtils::toRGBA(accumulator);
+        if (aovs != nullptr && aovs->has(AOV::SAMPLE_COUNT)) {
+            aovs->sampleCount[index] = numSamples;
+        }
+        if (timePixels) {
+            std::chrono::duration<float, std::micro> elapsed = std::chrono::steady_clock::now() - startTime;
+            aovs->time[index] = elapsed.count();
+        }
+        if (countPixels) {
+            storeCosts(*aovs, index, intersectionTests, shadowRays);
+        }
+        if (tiles.enabled()) {
+            tiles.end();
+        }
     };
 
 
-    // use QtConcurrent to run ray-tracing concurrently;
-    if (m_config.enableParallelism) {
-        QVector<int> indecies;
-        for (int i = 0; i < sceneWidth * sceneHeight; i++) {
+    QVector<int> indecies;
+    if (region != nullptr) {
+        for (int row = region->top; row < region->bottom; row++) {
+            for (int col = region->left; col < region->right; col++) {
+                indecies.append(row * sceneWidth + col);
+            }
+        }
+    } else {
+        for (int i = 0; i < frame.size(); i++) {
             indecies.append(i);
         }
+    }
 
+    // use QtConcurrent to run ray-tracing concurrently;
+    if (m_config.enableParallelism) {
         QtConcurrent::blockingMap(indecies, fillIndex);
     } else {
         // otherwise just use on single thread.
-        for (int i = 0; i < sceneWidth * sceneHeight; i++) {
+        for (int i : indecies) {
             fillIndex(i);
         }
     }
-
-    // apply a little blur at the end if post-processing is enabled to remove some noise
-    if (m_config.enablePostProcess) {
-        Filter::applyBlur(imageData, sceneWidth, sceneHeight, 1);
-    }
 }
+
@@ -1,8 +1,15 @@
 #pragma once
 
+#include <functional>
 #include <glm/glm.hpp>
 #include "utils/rgba.h"
+#include "utils/framebuffer.h"
+#include "utils/aov.h"
+#include "utils/intersection.h"
 #include "raytracescene.h"
+#include "dirtyregion.h"
+#include "gbuffer.h"
+#include "filter/denoiser.h"
 
 // A class representing a ray-tracer
 
@@ -10,19 +17,37 @@ class RayTracer
 {
 public:
     struct Config {
-        bool enableShadow        = false;
-        bool enableReflection    = false;
-        bool enableRefraction    = false;
-        bool enableTextureMap    = false;
-        bool enableTextureFilter = false;
-        bool enableParallelism   = false;
-        bool enableSuperSample   = false;
-        int  numSamples          =     0;
-        bool enablePostProcess   = false;
-        bool enableAcceleration  = false;
-        bool enableDepthOfField  = false;
+        bool enableShadow          = false;
+        bool enableReflection      = false;
+        bool enableRefraction      = false;
+        bool enableTextureMap      = false;
+        bool enableTextureFilter   = false;
+        bool enableParallelism     = false;
+        bool enableSuperSample     = false;
+        int  numSamples            =     0;
+        bool enablePostProcess     = false;
+        bool enableAcceleration    = false;
+        bool enableDepthOfField    = false;
+        bool enableDenoise         = false;
+        bool deterministicSampling = false; // Place super-samples by pixel position, not rand()
+
+        Denoiser::Config denoiser{};
+    };
+
+    // Features of the first surface a camera ray hits, captured for AOVs and the denoiser
+    struct Surface {
+        glm::vec3 normal    = glm::vec3(0.f);
+        glm::vec3 albedo    = glm::vec3(0.f);
+        glm::vec2 uv        = glm::vec2(0.f);
+        float     distance  = 0.f; // Distance along the ray, or 0 if the ray hit nothing
+        int       primitive = -1;  // Index into RayTraceScene::getPrims()
+        int       material  = -1;  // Index from RayTraceScene::getMaterialIds()
     };
 
+    // Receives each band of a banded render, along with the scene row the band starts at.
+    // Returning false stops the render.
+    using BandSink = std::function<bool(const FrameBuffer &band, int rowStart)>;
+
 public:
     RayTracer(Config config);
 
@@ -32,9 +57,49 @@ public:
     // @param scene The scene to be rendered.
     void render(RGBA *imageData, const RayTraceScene &scene);
 
-    glm::vec4 traceRay(const Ray &ray, const RayTraceScene &scene, const int depth = 0);
+    // Renders the scene synchronously into a floating-point frame, including any post-processing.
+    // No quantization happens here; the frame holds linear radiance.
+    // @param frame The frame to be filled, which must match the scene's dimensions.
+    // @param scene The scene to be rendered.
+    // @param aovs If given, its enabled channels are filled in as well. Disabled channels cost nothing.
+    void render(FrameBuffer &frame, const RayTraceScene &scene, AOV::Buffers *aovs = nullptr);
+
+    // Renders the scene synchronously a band of rows at a time, so that only one band is ever in memory.
+    // Post-processing is applied to each band over a halo of extra rows, so the result matches render().
+    // @param bandHeight The number of rows in each band.
+    // @param sink Called with each finished band, from the top of the image down.
+    // @return Whether every band was rendered, i.e. the sink never returned false.
+    bool renderBands(const RayTraceScene &scene, int bandHeight, const BandSink &sink);
+
+    // Traces only the pixels inside region again, leaving the rest of an already rendered frame as it is.
+    // No post-processing is applied, so frame should hold the previous frame from before its post-processing.
+    // @param gbuffer If given, the primary hits of the traced pixels are recorded in it.
+    void renderRegion(FrameBuffer &frame, const RayTraceScene &scene, const DirtyRegion::Rect &region,
+                      GBuffer *gbuffer = nullptr);
+
+    // Shades the primary hits recorded in a G-buffer again, without tracing any camera rays. Only valid while the
+    // camera and geometry are the ones the G-buffer was recorded with; lights and materials may have changed.
+    // No post-processing is applied.
+    void relight(FrameBuffer &frame, const RayTraceScene &scene, const GBuffer &gbuffer);
+
+    // Applies the enabled post-processing (denoising and blur) to a frame.
+    // @param aovs The frame's surface features, which must include AOV::DENOISER_GUIDES if denoising is enabled.
+    void postProcess(FrameBuffer &frame, const AOV::Buffers *aovs);
+
+    // Traces a single ray through the scene.
+    // @param surface If given, filled with the features of the first surface the ray hits.
+    glm::vec4 traceRay(const Ray &ray, const RayTraceScene &scene, const int depth = 0, Surface *surface = nullptr);
 
 private:
+    // The radius of the post-processing blur
+    static const int BLUR_RADIUS = 1;
+
+    glm::vec4 shade(const Ray &ray, const Intersection::Intersection &intersection, const SceneMaterial &material,
+                    int primIndex, const RayTraceScene &scene, const int depth, Surface *surface);
+    void renderRows(FrameBuffer &frame, const RayTraceScene &scene, int firstRow, AOV::Buffers *aovs,
+                    const DirtyRegion::Rect *region = nullptr, GBuffer *gbuffer = nullptr);
+    int filterHalo() const;
+
     const Config m_config;
 };
 
@@ -1,4 +1,5 @@
 #include "raytracerhelper.h"
+#include "utils/stats.h"
 
 /**
  * @brief RayTracerHelper::getIntersections - Gets a list of all valid intersections given a ray and a vector of world primitives
@@ -8,6 +9,7 @@
  */
 std::vector<Intersection::MaterialIntersection> RayTracerHelper::getIntersections(const Ray& ray,  const std::vector<WorldPrimitive::Proxy>& prims) {
     std::vector<Intersection::MaterialIntersection> intersections;
+    SKIPPY_STAT(INTERSECTION_TESTS, prims.size());
     for (auto &prim : prims) {
         std::optional<Intersection::MaterialIntersection> materialIntersection = prim(ray);
 
@@ -18,6 +20,36 @@ std::vector<Intersection::MaterialIntersection> RayTracerHelper::getIntersection
     return intersections;
 }
 
+/**
+ * @brief RayTracerHelper::getClosestIntersection - Finds the closest valid intersection given a ray and a vector of world
+ * primitives, along with the index of the primitive it belongs to
+ * @param ray - a ray in world space
+ * @param prims - a vector of world primitives to detect intersections with
+ * @return The closest intersection and its primitive's index, or nothing if the ray misses every primitive
+ */
+std::optional<std::tuple<Intersection::MaterialIntersection, int>> RayTracerHelper::getClosestIntersection(const Ray& ray, const std::vector<WorldPrimitive::Proxy>& prims) {
+    std::optional<std::tuple<Intersection::MaterialIntersection, int>> closest;
+    SKIPPY_STAT(INTERSECTION_TESTS, prims.size());
+
+    for (int i = 0; i < (int) prims.size(); i++) {
+        std::optional<Intersection::MaterialIntersection> materialIntersection = prims[i](ray);
+
+        if (!materialIntersection.has_value()) {
+            continue;
+        }
+
+        // emplace rather than assign, since assigning would write through the material reference
+        if (!closest.has_value() || Intersection::closer(std::get<0>(materialIntersection.value()), std::get<0>(std::get<0>(closest.value())))) {
+            closest.emplace(materialIntersection.value(), i);
+        }
+    }
+
+    if (closest.has_value()) {
+        SKIPPY_STAT(HITS, 1);
+    }
+    return closest;
+}
+
 /**
  * @brief RayTracerHelper::hasIntersection - Tells whether there is a valid intersection given a ray and some world primitives
  * @param ray - a ray in world space
@@ -25,6 +57,7 @@ std::vector<Intersection::MaterialIntersection> RayTracerHelper::getIntersection
  * @return A boolean denoting whether there is 1 or more valid intersections.
  */
 bool RayTracerHelper::hasIntersection(const Ray& ray,  const std::vector<WorldPrimitive::Proxy>& prims) {
+    SKIPPY_STAT(SHADOW_RAYS, 1);
     std::vector<Intersection::MaterialIntersection> intersections = getIntersections(ray, prims);
 
     return !intersections.empty();
@@ -39,6 +72,7 @@ bool RayTracerHelper::hasIntersection(const Ray& ray,  const std::vector<WorldPr
  * @return A boolean denoting whether there are any intersections closer to the origin of the ray than the provided position
  */
 bool RayTracerHelper::hasIntersectionBefore(const Ray& ray,  const std::vector<WorldPrimitive::Proxy>& prims, const glm::vec3& pos) {
+    SKIPPY_STAT(SHADOW_RAYS, 1);
     std::vector<Intersection::MaterialIntersection> intersections = getIntersections(ray, prims);
 
     float posT = ((pos - ray.getPos()) / ray.getDir())[0];
@@ -1,10 +1,13 @@
 #pragma once
 
+#include <optional>
+#include <tuple>
 #include <vector>
 #include "primitives/worldprimitive.h"
 
 namespace RayTracerHelper {
     std::vector<Intersection::MaterialIntersection> getIntersections(const Ray& ray, const std::vector<WorldPrimitive::Proxy>& prims);
+    std::optional<std::tuple<Intersection::MaterialIntersection, int>> getClosestIntersection(const Ray& ray, const std::vector<WorldPrimitive::Proxy>& prims);
     bool hasIntersection(const Ray& ray, const std::vector<WorldPrimitive::Proxy>& prims);
     bool hasIntersectionBefore(const Ray& ray,  const std::vector<WorldPrimitive::Proxy>& prims, const glm::vec3& pos);
 }
@@ -2,6 +2,28 @@
 
 #include "primitives/objectprimitives.h"
 #include "texture/texture.h"
+#include "utils/stats.h"
+#include "utils/trace.h"
+
+#include <algorithm>
+
+/**
+ * @brief Whether two materials would shade a surface identically
+ */
+bool RayTraceScene::sameMaterial(const SceneMaterial &a, const SceneMaterial &b) {
+    return a.cAmbient == b.cAmbient
+            && a.cDiffuse == b.cDiffuse
+            && a.cSpecular == b.cSpecular
+            && a.shininess == b.shininess
+            && a.cReflective == b.cReflective
+            && a.cTransparent == b.cTransparent
+            && a.ior == b.ior
+            && a.blend == b.blend
+            && a.textureMap.isUsed == b.textureMap.isUsed
+            && (!a.textureMap.isUsed || (a.textureMap.filename == b.textureMap.filename
+                                         && a.textureMap.repeatU == b.textureMap.repeatU
+                                         && a.textureMap.repeatV == b.textureMap.repeatV));
+}
 
 /**
  * @brief Builds all the shape primitives based off of RenderShapeData
@@ -9,10 +31,15 @@
  * @param renderShapes - A reference to all the shape data
  */
 void RayTraceScene::buildPrims(const std::vector<RenderShapeData> &renderShapes) {
+    // the first shape using each distinct material, whose position in this list is that material's id
+    std::vector<const SceneMaterial *> distinctMaterials;
+
     for (const RenderShapeData &renderShape : renderShapes) {
         const SceneMaterial& mat = renderShape.primitive.material;
-        if (mat.textureMap.isUsed && !m_textures.contains(mat.textureMap.filename)) {
-            Texture::load(mat.textureMap.filename, m_textures);
+        if (mat.textureMap.isUsed && !m_textures.contains(mat.textureMap.filename)
+                && std::find(m_failedTextures.begin(), m_failedTextures.end(), mat.textureMap.filename) == m_failedTextures.end()
+                && !Texture::load(mat.textureMap.filename, m_textures)) {
+            m_failedTextures.push_back(mat.textureMap.filename);
         }
 
         switch (renderShape.primitive.type) {
@@ -29,8 +56,20 @@ void RayTraceScene::buildPrims(const std::vector<RenderShapeData> &renderShapes)
                 m_prims.push_back(WorldPrimitive::Primitive(ObjectPrimitives::Sphere(), renderShape.ctm, mat));
                 break;
              default:
-                break;
+                continue;
         }
+
+        // give the new primitive the id of the first identical material, or a new id if there isn't one
+        auto match = std::find_if(distinctMaterials.begin(), distinctMaterials.end(), [&](const SceneMaterial *other) {
+            return sameMaterial(mat, *other);
+        });
+        if (match == distinctMaterials.end()) {
+            distinctMaterials.push_back(&mat);
+            match = distinctMaterials.end() - 1;
+        }
+        m_materialIds.push_back(match - distinctMaterials.begin());
+        m_materials.push_back(&mat);
+        m_shapeIndices.push_back(&renderShape - renderShapes.data());
     }
 }
 
@@ -63,6 +102,8 @@ RayTraceScene::RayTraceScene(int width, int height, const RenderData &metaData):
     m_canvasHeight(height),
     m_camera(metaData.cameraData, width / float(height))
 {
+    Stats::PhaseTimer timer(Stats::BUILD);
+    Trace::Span span("build scene");
     buildPrims(metaData.shapes);
     buildLights(metaData.lights);
 }
@@ -126,3 +167,40 @@ const std::vector<Lights::Proxy>& RayTraceScene::getLights() const {
 const std::map<std::string, Texture::Texture>& RayTraceScene::getTextures() const {
     return m_textures;
 }
+
+/**
+ * @brief Get the material id of every primitive, in the same order as getPrims()
+ *
+ * @return const std::vector<int>&
+ */
+const std::vector<int>& RayTraceScene::getMaterialIds() const {
+    return m_materialIds;
+}
+
+/**
+ * @brief Get the index of the shape in the scene's render data that every primitive was built from, in the same
+ * order as getPrims()
+ *
+ * @return const std::vector<int>&
+ */
+const std::vector<int>& RayTraceScene::getShapeIndices() const {
+    return m_shapeIndices;
+}
+
+/**
+ * @brief Get the texture files the scene uses that couldn't be loaded
+ *
+ * @return const std::vector<std::string>&
+ */
+const std::vector<std::string>& RayTraceScene::getFailedTextures() const {
+    return m_failedTextures;
+}
+
+/**
+ * @brief Get the material of every primitive, in the same order as getPrims()
+ *
+ * @return const std::vector<const SceneMaterial *>&
+ */
+const std::vector<const SceneMaterial *>& RayTraceScene::getMaterials() const {
+    return m_materials;
+}
@@ -38,6 +38,22 @@ public:
     const std::vector<Lights::Proxy>& getLights() const;
     const std::map<std::string, Texture::Texture>& getTextures() const;
 
+    // The material id of each primitive, parallel to getPrims(). Primitives with identical materials share an id.
+    const std::vector<int>& getMaterialIds() const;
+
+    // The material of each primitive, parallel to getPrims()
+    const std::vector<const SceneMaterial *>& getMaterials() const;
+
+    // The index in RenderData::shapes each primitive was built from, parallel to getPrims(). Shapes of types the
+    // tracer doesn't support have no primitive, so the two only line up when every shape is supported.
+    const std::vector<int>& getShapeIndices() const;
+
+    // The texture files that couldn't be loaded. A scene that's missing any can't be rendered.
+    const std::vector<std::string>& getFailedTextures() const;
+
+    // Whether two materials would shade a surface identically
+    static bool sameMaterial(const SceneMaterial &a, const SceneMaterial &b);
+
 private:
 //    static const std::vector<Shape> buildShapes(const std::vector<RenderShapeData>& renderShapes);
     void buildPrims(const std::vector<RenderShapeData>& renderShapes);
@@ -50,6 +66,10 @@ private:
 
 //    const std::vector<Shape> m_shapes;
     std::vector<WorldPrimitive::Proxy> m_prims;
+    std::vector<int> m_materialIds;
+    std::vector<const SceneMaterial *> m_materials;
+    std::vector<int> m_shapeIndices;
     std::vector<Lights::Proxy> m_lights;
     std::map<std::string, Texture::Texture> m_textures;
+    std::vector<std::string> m_failedTextures;
 };
@@ -0,0 +1,204 @@
+#include "scenehash.h"
+
+#include <filesystem>
+#include <set>
+
+namespace SceneHash {
+    static const Hash FNV_PRIME = 1099511628211ull;
+
+    void Hasher::add(const void *bytes, std::size_t size) {
+        const unsigned char *data = static_cast<const unsigned char *>(bytes);
+        for (std::size_t i = 0; i < size; i++) {
+            m_state = (m_state ^ data[i]) * FNV_PRIME;
+        }
+    }
+
+    void Hasher::add(bool value) {
+        add(value ? 1 : 0);
+    }
+
+    void Hasher::add(int value) {
+        const std::int32_t fixed = value;
+        add(&fixed, sizeof(fixed));
+    }
+
+    void Hasher::add(float value) {
+        // -0 and 0 render the same, so they have to hash the same
+        if (value == 0.f) {
+            value = 0.f;
+        }
+        add(&value, sizeof(value));
+    }
+
+    void Hasher::add(const std::string &value) {
+        // the length keeps consecutive strings from running into each other
+        add(int(value.size()));
+        add(value.data(), value.size());
+    }
+
+    void Hasher::add(const glm::vec3 &value) {
+        for (int i = 0; i < 3; i++) {
+            add(value[i]);
+        }
+    }
+
+    void Hasher::add(const glm::vec4 &value) {
+        for (int i = 0; i < 4; i++) {
+            add(value[i]);
+        }
+    }
+
+    void Hasher::add(const glm::mat4 &value) {
+        for (int i = 0; i < 4; i++) {
+            add(value[i]);
+        }
+    }
+
+    static void addMaterial(Hasher &hasher, const SceneMaterial &material) {
+        hasher.add(material.cAmbient);
+        hasher.add(material.cDiffuse);
+        hasher.add(material.cSpecular);
+        hasher.add(material.shininess);
+        hasher.add(material.cReflective);
+        hasher.add(material.cTransparent);
+        hasher.add(material.ior);
+        hasher.add(material.textureMap.isUsed);
+        if (material.textureMap.isUsed) {
+            hasher.add(material.textureMap.filename);
+            hasher.add(material.textureMap.repeatU);
+            hasher.add(material.textureMap.repeatV);
+            hasher.add(material.blend);
+        }
+    }
+
+    static void addLight(Hasher &hasher, const SceneLightData &light) {
+        hasher.add(int(light.type));
+        hasher.add(light.color);
+
+        // each kind of light only reads some of the fields
+        if (light.type != LightType::LIGHT_DIRECTIONAL) {
+            hasher.add(light.pos);
+            hasher.add(light.function);
+        }
+        if (light.type != LightType::LIGHT_POINT) {
+            hasher.add(light.dir);
+        }
+        if (light.type == LightType::LIGHT_SPOT) {
+            hasher.add(light.penumbra);
+            hasher.add(light.angle);
+        }
+    }
+
+    /**
+     * @brief add - adds the globals, camera, lights and shapes of a frame to a hash. The frame rate, duration and ids
+     * don't change the image and are left out.
+     * @param hasher - the hash to add to
+     * @param data - the frame's scene data
+     */
+    void add(Hasher &hasher, const RenderData &data) {
+        const SceneGlobalData &globals = data.globalData;
+        hasher.add(globals.ka);
+        hasher.add(globals.kd);
+        hasher.add(globals.ks);
+        hasher.add(globals.kt);
+
+        const SceneCameraData &camera = data.cameraData;
+        hasher.add(camera.pos);
+        hasher.add(camera.look);
+        hasher.add(camera.up);
+        hasher.add(camera.heightAngle);
+        hasher.add(camera.aperture);
+        hasher.add(camera.focalLength);
+
+        hasher.add(int(data.lights.size()));
+        for (const SceneLightData &light : data.lights) {
+            addLight(hasher, light);
+        }
+
+        hasher.add(int(data.shapes.size()));
+        for (const RenderShapeData &shape : data.shapes) {
+            hasher.add(int(shape.primitive.type));
+            hasher.add(shape.primitive.meshfile);
+            hasher.add(shape.ctm);
+            addMaterial(hasher, shape.primitive.material);
+        }
+    }
+
+    /**
+     * @brief addFileStamps - adds the size and modification time of each file the frame reads to a hash. A missing
+     * file is hashed as such, so it still changes the hash once it appears.
+     * @param hasher - the hash to add to
+     * @param data - the frame's scene data
+     */
+    void addFileStamps(Hasher &hasher, const RenderData &data) {
+        // each file only counts once, in a fixed order
+        std::set<std::string> files;
+        for (const RenderShapeData &shape : data.shapes) {
+            if (shape.primitive.material.textureMap.isUsed) {
+                files.insert(shape.primitive.material.textureMap.filename);
+            }
+            if (!shape.primitive.meshfile.empty()) {
+                files.insert(shape.primitive.meshfile);
+            }
+        }
+
+        for (const std::string &file : files) {
+            std::error_code error;
+            const std::uintmax_t size = std::filesystem::file_size(file, error);
+            const bool exists = !error;
+            const auto modified = std::filesystem::last_write_time(file, error).time_since_epoch().count();
+
+            hasher.add(file);
+            hasher.add(exists);
+            if (exists) {
+                hasher.add(&size, sizeof(size));
+                hasher.add(&modified, sizeof(modified));
+            }
+        }
+    }
+
+    /**
+     * @brief add - adds the settings of a tracer to a hash, skipping the ones that only change how fast it runs
+     * @param hasher - the hash to add to
+     * @param config - the tracer's config
+     */
+    void add(Hasher &hasher, const RayTracer::Config &config) {
+        hasher.add(config.enableShadow);
+        hasher.add(config.enableReflection);
+        hasher.add(config.enableRefraction);
+        hasher.add(config.enableTextureMap);
+        hasher.add(config.enableTextureFilter);
+        hasher.add(config.enableSuperSample);
+        if (config.enableSuperSample) {
+            hasher.add(config.numSamples);
+            hasher.add(config.deterministicSampling);
+        }
+        hasher.add(config.enablePostProcess);
+        hasher.add(config.enableDepthOfField);
+        hasher.add(config.enableDenoise);
+        if (config.enableDenoise) {
+            hasher.add(config.denoiser.iterations);
+            hasher.add(config.denoiser.sigmaColor);
+            hasher.add(config.denoiser.sigmaNormal);
+            hasher.add(config.denoiser.sigmaAlbedo);
+            hasher.add(config.denoiser.sigmaDepth);
+        }
+    }
+
+    /**
+     * @brief of - hashes everything that determines the traced image of a frame
+     * @param data - the frame's scene data
+     * @param width - the width of the image
+     * @param height - the height of the image
+     * @param config - the tracer's config
+     * @return the hash
+     */
+    Hash of(const RenderData &data, int width, int height, const RayTracer::Config &config) {
+        Hasher hasher;
+        hasher.add(width);
+        hasher.add(height);
+        add(hasher, config);
+        add(hasher, data);
+        return hasher.value();
+    }
+}
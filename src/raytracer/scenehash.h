@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <glm/glm.hpp>
+#include "raytracer.h"
+#include "utils/sceneparser.h"
+
+// Canonical hashes of everything that goes into rendering a frame. Only the inputs the tracer actually reads are
+// hashed (e.g. a directional light's position is left out), so two frames with the same hash render to the same
+// image and one can stand in for the other.
+namespace SceneHash {
+    using Hash = std::uint64_t;
+
+    // Bump this whenever a change to the tracer changes the images it produces, so hashes from older builds (e.g. in
+    // the frame cache) stop matching
+    const int RENDERER_VERSION = 1;
+
+    // Builds a 64-bit FNV-1a hash from a sequence of values
+    class Hasher {
+    public:
+        void add(const void *bytes, std::size_t size);
+        void add(bool value);
+        void add(int value);
+        void add(float value);
+        void add(const std::string &value);
+        void add(const glm::vec3 &value);
+        void add(const glm::vec4 &value);
+        void add(const glm::mat4 &value);
+
+        Hash value() const { return m_state; }
+
+    private:
+        Hash m_state = 14695981039346656037ull;
+    };
+
+    // Adds a frame's render inputs to a hash
+    void add(Hasher &hasher, const RenderData &data);
+
+    // Adds the size and modification time of every file a frame reads (textures and meshes) to a hash, so that
+    // editing one of them changes the hash even though the scene itself didn't change
+    void addFileStamps(Hasher &hasher, const RenderData &data);
+
+    // Adds the tracer settings that affect what a frame looks like to a hash
+    void add(Hasher &hasher, const RayTracer::Config &config);
+
+    // Hashes everything that determines the traced image of a frame
+    Hash of(const RenderData &data, int width, int height, const RayTracer::Config &config);
+}
@@ -0,0 +1,222 @@
+#include "renderserver.h"
+
+#include <QDir>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include "farm/frameselection.h"
+#include "output/atomicfile.h"
+#include "output/framewriter.h"
+#include "texture/texture.h"
+#include "utils/rendersettings.h"
+
+RenderServer::RenderServer(const QString &configPath, int maxScenes) :
+    m_settings(configPath, QSettings::IniFormat),
+    m_scenes(maxScenes)
+{
+    QObject::connect(&m_server, &QLocalServer::newConnection, [this]() { accept(); });
+}
+
+/**
+ * @brief RenderServer::listen - start accepting clients
+ * @param name - the name of the local socket (a path, or a name in the system's socket directory)
+ * @return whether the socket could be opened
+ */
+bool RenderServer::listen(const QString &name) {
+    QLocalServer::removeServer(name);
+    return m_server.listen(name);
+}
+
+/**
+ * @brief RenderServer::accept - take every waiting connection and start listening to it
+ */
+void RenderServer::accept() {
+    while (QLocalSocket *socket = m_server.nextPendingConnection()) {
+        m_jobs[socket] = Job{};
+
+        QObject::connect(socket, &QLocalSocket::readyRead, [this, socket]() {
+            while (socket->canReadLine()) {
+                handleLine(socket, socket->readLine().trimmed());
+            }
+        });
+
+        QObject::connect(socket, &QLocalSocket::disconnected, [this, socket]() {
+            m_jobs.erase(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+/**
+ * @brief RenderServer::handleLine - add a line to the job a client is describing, or run it
+ */
+void RenderServer::handleLine(QLocalSocket *socket, const QByteArray &line) {
+    if (line.isEmpty()) {
+        return;
+    }
+
+    // the command is the first word, and its argument is the rest of the line, which may contain spaces
+    const int space = line.indexOf(' ');
+    const QByteArray command = space < 0 ? line : line.left(space);
+    const QString argument = space < 0 ? QString() : QString::fromUtf8(line.mid(space + 1)).trimmed();
+    auto described = m_jobs.find(socket);
+    if (described == m_jobs.end()) {
+        return;
+    }
+    Job &job = described->second;
+
+    if (command == "SCENE") {
+        job.scene = argument;
+    } else if (command == "OUTPUT") {
+        job.output = argument;
+    } else if (command == "FRAMES") {
+        job.frames = argument;
+    } else if (command == "STRIDE") {
+        job.stride = std::max(argument.toInt(), 1);
+    } else if (command == "SET") {
+        const int split = argument.indexOf(' ');
+        if (split < 0) {
+            send(socket, "ERROR SET needs a setting and a value, e.g. SET Canvas/width 640");
+            return;
+        }
+        job.overrides[argument.left(split)] = argument.mid(split + 1).trimmed();
+    } else if (command == "RENDER") {
+        // the next job on this connection starts from scratch
+        Job finished = job;
+        job = Job{};
+        run(socket, finished);
+    } else {
+        send(socket, "ERROR unknown command \"" + command + "\"");
+    }
+}
+
+/**
+ * @brief RenderServer::run - render a job, reporting each frame to its client as it's written
+ * @param socket - the client that sent the job
+ * @param job - the job
+ */
+void RenderServer::run(QLocalSocket *socket, const Job &job) {
+    const auto start = std::chrono::steady_clock::now();
+    const RenderSettings::Lookup value = RenderSettings::from(m_settings, job.overrides);
+
+    const QString scenePath = job.scene.isEmpty() ? value("IO/scene", QString()).toString() : job.scene;
+    const QString outputPath = job.output.isEmpty() ? value("IO/output", QString()).toString() : job.output;
+    const int width = value("Canvas/width", 0).toInt();
+    const int height = value("Canvas/height", 0).toInt();
+    const std::string format = value("Output/format", "png").toString().toStdString();
+
+    auto fail = [&](const QString &message) {
+        send(socket, "ERROR " + message.toUtf8());
+    };
+
+    if (width <= 0 || height <= 0) {
+        fail("the canvas size has to be positive");
+        return;
+    }
+    if (!FrameWriter::isFormat(format)) {
+        fail("unknown output format \"" + QString::fromStdString(format) + "\"");
+        return;
+    }
+
+    ToneMap::Config toneMapConfig{};
+    if (!RenderSettings::toneMapConfig(value, toneMapConfig)) {
+        fail("unknown tone mapping operator \"" + value("Output/tonemap", QString()).toString() + "\"");
+        return;
+    }
+    const int pngQuality = RenderSettings::pngQuality(value);
+    const RayTracer::Config rtConfig = RenderSettings::rayTracerConfig(value);
+
+    bool wasCached = false;
+    std::shared_ptr<const Skippy::Scene> scene = m_scenes.get(scenePath.toStdString(), wasCached);
+    if (!scene) {
+        fail("failed to load the scene \"" + scenePath + "\"");
+        return;
+    }
+
+    const int numFrames = scene->frameCount();
+    int firstFrame = 0;
+    int lastFrame = numFrames - 1;
+    if (!job.frames.isEmpty() && !FrameSelection::parseRange(job.frames.toStdString(), numFrames, firstFrame, lastFrame)) {
+        fail("invalid frame range \"" + job.frames + "\" for an animation of " + QString::number(numFrames) + " frames");
+        return;
+    }
+    const std::vector<int> frames = FrameSelection::select(firstFrame, lastFrame, job.stride);
+
+    // decode every texture up front, so a job whose textures can't be read is turned away before it starts; the
+    // frames' scenes then find them already decoded
+    std::set<std::string> textures;
+    for (int frame : frames) {
+        for (const RenderShapeData &shape : scene->frame(frame).shapes) {
+            if (shape.primitive.material.textureMap.isUsed) {
+                textures.insert(shape.primitive.material.textureMap.filename);
+            }
+        }
+    }
+    for (const std::string &texture : textures) {
+        std::map<std::string, Texture::Texture> loaded;
+        if (!Texture::load(texture, loaded)) {
+            fail("failed to load the texture \"" + QString::fromStdString(texture) + "\"");
+            return;
+        }
+    }
+
+    if (!QDir().mkpath(outputPath)) {
+        fail("failed to create the output directory \"" + outputPath + "\"");
+        return;
+    }
+
+    const int jobId = m_nextJob++;
+    std::cout << "Job " << jobId << ": " << frames.size() << " frame(s) of \"" << scenePath.toStdString() << "\" ("
+              << (wasCached ? "cached" : "parsed") << ", " << Texture::cachedCount() << " texture(s) cached)" << std::endl;
+    send(socket, "ACCEPTED " + QByteArray::number(jobId) + " " + QByteArray::number(int(frames.size())));
+
+    int done = 0;
+    int failed = 0;
+    for (int frame : frames) {
+        // nobody is left to hear about the rest of the job
+        if (socket->state() != QLocalSocket::ConnectedState) {
+            std::cout << "Job " << jobId << ": the client disconnected, so the job was dropped" << std::endl;
+            return;
+        }
+
+        // a texture can still fail to load here if its file changed since the job started
+        FrameBuffer frameBuffer(width, height);
+        const bool rendered = Skippy::render(scene->frame(frame), frameBuffer, rtConfig);
+
+        const QString framePath = QStringLiteral("%1/frame%2.%3")
+                .arg(outputPath).arg(frame, 5, 10, QLatin1Char('0')).arg(QString::fromStdString(format));
+
+        bool success = rendered && AtomicFile::write(framePath.toStdString(), [&](const std::string &partial) {
+            if (FrameWriter::isFloat(format)) {
+                return FrameWriter::writeFloat(partial, format, frameBuffer);
+            }
+
+            std::vector<RGBA> pixels(frameBuffer.size());
+            ToneMap::apply(frameBuffer, pixels.data(), toneMapConfig, rtConfig.enableParallelism);
+            return FrameWriter::writeBytes(partial, format, pixels.data(), width, height, pngQuality);
+        });
+
+        if (success) {
+            send(socket, "FRAME " + QByteArray::number(frame) + " " + framePath.toUtf8());
+        } else {
+            failed++;
+            send(socket, "FAILED " + QByteArray::number(frame));
+        }
+        send(socket, "PROGRESS " + QByteArray::number(++done) + " " + QByteArray::number(int(frames.size())));
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    send(socket, "DONE " + QByteArray::number(jobId) + " " + QByteArray::number(failed) + " " + QByteArray::number(seconds, 'f', 3));
+}
+
+/**
+ * @brief RenderServer::send - write a line to a client straight away, since jobs block the event loop while they run
+ * @return whether the line was written
+ */
+bool RenderServer::send(QLocalSocket *socket, const QByteArray &line) {
+    if (socket->state() != QLocalSocket::ConnectedState) {
+        return false;
+    }
+    socket->write(line + "\n");
+    return socket->waitForBytesWritten(30000);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSettings>
+#include <QVariantMap>
+#include <map>
+#include "scenecache.h"
+
+// A long-lived renderer that takes jobs over a local socket. Parsed scenes and decoded textures stay in memory
+// between jobs, so rendering a scene again (say, after tweaking a setting) skips straight to tracing. Jobs run one at
+// a time, in the order they arrive, on the Qt event loop.
+//
+// Each message is one line of text:
+//   client -> server: "SCENE <path>", "OUTPUT <dir>", "FRAMES <range>", "STRIDE <n>" and "SET <Section/key> <value>"
+//                     describe a job, and "RENDER" queues it. Anything left out comes from the server's config file.
+//   server -> client: "ACCEPTED <job> <frames>", then "FRAME <frame> <path>" or "FAILED <frame>" and
+//                     "PROGRESS <done> <total>" for each frame, and finally "DONE <job> <failed> <seconds>".
+//                     A job that can't start gets "ERROR <message>" instead.
+class RenderServer {
+public:
+    RenderServer(const QString &configPath, int maxScenes);
+
+    // Starts accepting clients on the named local socket, replacing a stale socket left by a crashed server
+    bool listen(const QString &name);
+
+private:
+    struct Job {
+        QString scene;
+        QString output;
+        QString frames;
+        int stride = 1;
+        QVariantMap overrides;
+    };
+
+    void accept();
+    void handleLine(QLocalSocket *socket, const QByteArray &line);
+    void run(QLocalSocket *socket, const Job &job);
+    static bool send(QLocalSocket *socket, const QByteArray &line);
+
+    QSettings m_settings;
+    SceneCache m_scenes;
+    QLocalServer m_server;
+    std::map<QLocalSocket *, Job> m_jobs; // The job each client is describing
+    int m_nextJob = 0;
+};
@@ -0,0 +1,48 @@
+#include "scenecache.h"
+
+#include <algorithm>
+
+SceneCache::SceneCache(int maxScenes) :
+    m_maxScenes(std::max(maxScenes, 1))
+{}
+
+/**
+ * @brief SceneCache::get - look a scene up, parsing it if it isn't cached or its file has changed since
+ * @param path - the scene file
+ * @param wasCached - set to whether the cached frames could be used
+ * @return the scene, or null if it couldn't be parsed
+ */
+std::shared_ptr<const Skippy::Scene> SceneCache::get(const std::string &path, bool &wasCached) {
+    std::error_code error;
+    const std::string key = std::filesystem::absolute(path, error).lexically_normal().string();
+    const auto modified = std::filesystem::last_write_time(path, error);
+    wasCached = false;
+
+    auto cached = m_entries.find(key);
+    if (cached != m_entries.end() && !error && cached->second.modified == modified) {
+        cached->second.lastUsed = ++m_clock;
+        wasCached = true;
+        return cached->second.scene;
+    }
+
+    std::shared_ptr<const Skippy::Scene> scene = Skippy::Scene::load(path);
+    if (!scene) {
+        m_entries.erase(key);
+        return nullptr;
+    }
+
+    m_entries[key] = Entry{ modified, scene, ++m_clock };
+
+    while (int(m_entries.size()) > m_maxScenes) {
+        auto oldest = std::min_element(m_entries.begin(), m_entries.end(), [](const auto &a, const auto &b) {
+            return a.second.lastUsed < b.second.lastUsed;
+        });
+        m_entries.erase(oldest);
+    }
+
+    return scene;
+}
+
+int SceneCache::size() const {
+    return int(m_entries.size());
+}
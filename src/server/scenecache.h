@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include "core/skippy.h"
+
+// Parsed scene files, kept between render jobs so a scene that's rendered again isn't parsed again. A scene is parsed
+// again once its file changes, and the least recently used scenes are dropped past a limit.
+class SceneCache {
+public:
+    explicit SceneCache(int maxScenes);
+
+    // A scene file, parsed only if it isn't cached already
+    // @param wasCached Set to whether the scene came from the cache.
+    // @return The scene, or null if the file can't be parsed.
+    std::shared_ptr<const Skippy::Scene> get(const std::string &path, bool &wasCached);
+
+    int size() const;
+
+private:
+    struct Entry {
+        std::filesystem::file_time_type modified;
+        std::shared_ptr<const Skippy::Scene> scene; // Shared, so a scene dropped mid-job lives until the job is done with it
+        std::uint64_t lastUsed;
+    };
+
+    const int m_maxScenes;
+    std::map<std::string, Entry> m_entries;
+    std::uint64_t m_clock = 0;
+};
@@ -1,40 +1,122 @@
 #include "texture.h"
 
 #include <QImage>
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
+#include <mutex>
 
 #include "utils/colorutils.h"
+#include "utils/stats.h"
 
 /**
- * @brief Texture::load - Given a filenam and a map of filenames to Textures, load the texture image into the map
+ * @brief decode - read a texture image from disk
  * @param filename - the filename pointing to the texture image
- * @param textures - a map of file strings to textures
+ * @param texture - set to the decoded image on success
+ * @return whether the image could be read
  */
-void Texture::load(const std::string filename, std::map<std::string, Texture>& textures) {
+static bool decode(const std::string &filename, Texture::Texture &texture) {
     const QString file = QString(filename.c_str());
     QImage textureImg;
 
     if (!textureImg.load(file)) {
-        std::cout << "Critical ERROR: Failed to load texture." << std::endl;
-        exit(1);
+        return false;
     }
 
     textureImg = textureImg.convertToFormat(QImage::Format_RGBX8888);
     QByteArray textureBytes = QByteArray::fromRawData((const char*) textureImg.bits(), textureImg.sizeInBytes());
 
-    const int width = textureImg.width();
-    const int height = textureImg.height();
-
-    textures[filename] = Texture{ width, height, std::vector<RGBA>() };
-    Texture& texture = textures[filename];
-
+    texture = Texture::Texture{ textureImg.width(), textureImg.height(), std::vector<RGBA>() };
     texture.img.reserve(textureImg.width() * textureImg.height());
 
     for (int i = 0; i < textureBytes.size() / 4.f; i++){
        texture.img.push_back(RGBA{(std::uint8_t) textureBytes[4*i], (std::uint8_t) textureBytes[4*i+1], (std::uint8_t) textureBytes[4*i+2], (std::uint8_t) textureBytes[4*i+3]});
     }
 
-    return;
+    return true;
+}
+
+// Every scene (one per frame) loads its own textures, so decoded images are kept between scenes and only decoded
+// again once their file changes, or once they haven't been used for long enough to be pushed out by newer ones
+namespace {
+    struct CachedTexture {
+        std::filesystem::file_time_type modified;
+        Texture::Texture texture;
+        std::uint64_t lastUsed;
+    };
+
+    std::mutex cacheMutex;
+    std::map<std::string, CachedTexture> cache;
+    std::size_t cacheBytes = 0;
+    std::size_t cacheLimit = 0;
+    std::uint64_t cacheClock = 0;
+
+    std::size_t sizeOf(const Texture::Texture &texture) {
+        return texture.img.size() * sizeof(RGBA);
+    }
+
+    // Drops the least recently used images until the cache fits its limit, always keeping the one just used
+    void evict() {
+        while (cacheLimit > 0 && cacheBytes > cacheLimit && cache.size() > 1) {
+            auto oldest = std::min_element(cache.begin(), cache.end(), [](const auto &a, const auto &b) {
+                return a.second.lastUsed < b.second.lastUsed;
+            });
+            cacheBytes -= sizeOf(oldest->second.texture);
+            cache.erase(oldest);
+        }
+    }
+}
+
+/**
+ * @brief Texture::load - Given a filenam and a map of filenames to Textures, load the texture image into the map
+ * @param filename - the filename pointing to the texture image
+ * @param textures - a map of file strings to textures
+ * @return whether the image could be read
+ */
+bool Texture::load(const std::string filename, std::map<std::string, Texture>& textures) {
+    std::error_code error;
+    const auto modified = std::filesystem::last_write_time(filename, error);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    auto cached = cache.find(filename);
+    if (cached == cache.end() || error || cached->second.modified != modified) {
+        if (cached != cache.end()) {
+            cacheBytes -= sizeOf(cached->second.texture);
+            cache.erase(cached);
+        }
+
+        Texture texture;
+        if (!decode(filename, texture)) {
+            std::cerr << "Error: failed to load the texture \"" << filename << "\"" << std::endl;
+            return false;
+        }
+        cacheBytes += sizeOf(texture);
+        cached = cache.insert_or_assign(filename, CachedTexture{ modified, std::move(texture), 0 }).first;
+    }
+    cached->second.lastUsed = ++cacheClock;
+
+    textures[filename] = cached->second.texture;
+    evict();
+    return true;
+}
+
+/**
+ * @brief Texture::setCacheLimit - bound the memory kept by decoded images, dropping any that no longer fit
+ * @param bytes - the most bytes of pixels to keep, or 0 for no limit
+ */
+void Texture::setCacheLimit(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cacheLimit = bytes;
+    evict();
+}
+
+/**
+ * @brief Texture::cachedCount - the number of decoded images kept for later scenes
+ */
+int Texture::cachedCount() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return int(cache.size());
 }
 
 /**
@@ -45,6 +127,7 @@ void Texture::load(const std::string filename, std::map<std::string, Texture>& t
  * @return The color of the texture at that uv
  */
 glm::vec4 Texture::getPixel(const std::tuple<float, float>& uv, const Texture& texture, const SceneMaterial& material) {
+    SKIPPY_STAT(TEXTURE_SAMPLES, 1);
     auto& [u, v] = uv;
 
     int col = (int) floor(u * texture.width * material.textureMap.repeatU) % texture.width;
@@ -3,6 +3,7 @@
 #include "utils/rgba.h"
 #include "utils/scenedata.h"
 
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <map>
@@ -16,6 +17,12 @@ namespace Texture {
         std::vector<RGBA> img;
     };
 
-    void load(const std::string filename, std::map<std::string, Texture>& textures);
+    // Decoded images are shared by every scene in the process, so a texture is only decoded again once its file changes
+    // @return false if the image can't be read, in which case it isn't added to textures.
+    bool load(const std::string filename, std::map<std::string, Texture>& textures);
+    int cachedCount();
+
+    // Drops the least recently used decoded images once those kept add up to more than this many bytes, or never if 0
+    void setCacheLimit(std::size_t bytes);
     glm::vec4 getPixel(const std::tuple<float, float>& uv, const Texture& texture, const SceneMaterial& material);
 }
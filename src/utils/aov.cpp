@@ -0,0 +1,98 @@
+#include "aov.h"
+
+namespace AOV {
+    Buffers::Buffers(int width, int height, unsigned channels) :
+        width(width),
+        height(height)
+    {
+        enable(channels);
+    }
+
+    /**
+     * @brief Buffers::enable - allocates the buffers for any of the given channels that aren't already enabled
+     * @param newChannels - a mask of Channel values
+     */
+    void Buffers::enable(unsigned newChannels) {
+        const int size = width * height;
+        const unsigned added = newChannels & ~channels;
+
+        if (added & DEPTH)         { depth.assign(size, 0.f); }
+        if (added & NORMAL)        { normal.assign(size, glm::vec3(0.f)); }
+        if (added & ALBEDO)        { albedo.assign(size, glm::vec3(0.f)); }
+        if (added & PRIMITIVE_ID)  { primitiveId.assign(size, -1.f); }
+        if (added & MATERIAL_ID)   { materialId.assign(size, -1.f); }
+        if (added & HIT_T)         { hitT.assign(size, 0.f); }
+        if (added & SAMPLE_COUNT)  { sampleCount.assign(size, 0.f); }
+        if (added & TIME)          { time.assign(size, 0.f); }
+        if (added & INTERSECTIONS) { intersections.assign(size, 0.f); }
+        if (added & SHADOW_RAYS)   { shadowRays.assign(size, 0.f); }
+        if (added & RECURSION)     { recursion.assign(size, 0.f); }
+
+        channels |= newChannels;
+    }
+
+    /**
+     * @brief Buffers::components - the number of floats stored per pixel for a channel
+     */
+    int Buffers::components(Channel channel) const {
+        return (channel == NORMAL || channel == ALBEDO) ? 3 : 1;
+    }
+
+    /**
+     * @brief Buffers::data - a pointer to the raw floats of a channel, laid out row by row from the top of the
+     * image with components() floats per pixel
+     */
+    const float *Buffers::data(Channel channel) const {
+        switch (channel) {
+            case DEPTH:         return depth.data();
+            case NORMAL:        return &normal.data()->x;
+            case ALBEDO:        return &albedo.data()->x;
+            case PRIMITIVE_ID:  return primitiveId.data();
+            case MATERIAL_ID:   return materialId.data();
+            case HIT_T:         return hitT.data();
+            case SAMPLE_COUNT:  return sampleCount.data();
+            case TIME:          return time.data();
+            case INTERSECTIONS: return intersections.data();
+            case SHADOW_RAYS:   return shadowRays.data();
+            case RECURSION:     return recursion.data();
+            default:            return nullptr;
+        }
+    }
+
+    /**
+     * @brief channelName - the name a channel goes by in config files and output file names
+     */
+    std::string channelName(Channel channel) {
+        switch (channel) {
+            case DEPTH:         return "depth";
+            case NORMAL:        return "normal";
+            case ALBEDO:        return "albedo";
+            case PRIMITIVE_ID:  return "primitive-id";
+            case MATERIAL_ID:   return "material-id";
+            case HIT_T:         return "hit-t";
+            case SAMPLE_COUNT:  return "sample-count";
+            case TIME:          return "time";
+            case INTERSECTIONS: return "intersections";
+            case SHADOW_RAYS:   return "shadow-rays";
+            case RECURSION:     return "recursion";
+            default:            return "unknown";
+        }
+    }
+
+    /**
+     * @brief parseChannel - looks up a channel by its name
+     * @param name - a name as returned by channelName
+     * @param channel - set to the matching channel on success
+     * @return whether the name was recognized
+     */
+    bool parseChannel(const std::string &name, Channel &channel) {
+        for (Channel candidate : ALL_CHANNELS) {
+            if (channelName(candidate) == name) {
+                channel = candidate;
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Arbitrary output variables: extra per-pixel channels a render can produce alongside its color
+namespace AOV {
+    enum Channel : unsigned {
+        DEPTH         = 1 << 0,  // Camera-space depth of the first hit
+        NORMAL        = 1 << 1,  // World-space normal of the first hit
+        ALBEDO        = 1 << 2,  // Unlit diffuse color of the first hit
+        PRIMITIVE_ID  = 1 << 3,  // Index of the primitive hit first, or -1
+        MATERIAL_ID   = 1 << 4,  // Index of the (deduplicated) material hit first, or -1
+        HIT_T         = 1 << 5,  // Distance along the camera ray to the first hit
+        SAMPLE_COUNT  = 1 << 6,  // Number of samples taken for the pixel
+        TIME          = 1 << 7,  // Wall time spent on the pixel, in microseconds
+        INTERSECTIONS = 1 << 8,  // Rays tested against a single primitive for the pixel, over all its samples
+        SHADOW_RAYS   = 1 << 9,  // Shadow rays traced for the pixel, over all its samples
+        RECURSION     = 1 << 10  // Deepest reflection any of the pixel's samples went
+    };
+
+    // Every channel, in the order they're listed above
+    const std::vector<Channel> ALL_CHANNELS = {
+        DEPTH, NORMAL, ALBEDO, PRIMITIVE_ID, MATERIAL_ID, HIT_T, SAMPLE_COUNT, TIME, INTERSECTIONS, SHADOW_RAYS, RECURSION
+    };
+
+    // The channels Denoiser reads its edge-stopping features from
+    const unsigned DENOISER_GUIDES = NORMAL | ALBEDO | HIT_T;
+
+    // The channels measuring what a pixel cost to trace, which heatmaps can be drawn of
+    const unsigned COST_CHANNELS = TIME | INTERSECTIONS | SHADOW_RAYS | RECURSION;
+
+    // Side buffers for a set of channels. Only the enabled channels are allocated; the others stay empty.
+    // Pixels whose camera rays miss everything keep zeros (or -1 for the ids) in the hit-dependent channels.
+    struct Buffers {
+        Buffers(int width, int height, unsigned channels);
+
+        void enable(unsigned channels);
+        bool has(Channel channel) const { return (channels & channel) != 0; }
+        int components(Channel channel) const;
+        const float *data(Channel channel) const;
+
+        int width;
+        int height;
+        unsigned channels = 0;
+
+        std::vector<float> depth;
+        std::vector<glm::vec3> normal;
+        std::vector<glm::vec3> albedo;
+        std::vector<float> primitiveId;
+        std::vector<float> materialId;
+        std::vector<float> hitT;
+        std::vector<float> sampleCount;
+        std::vector<float> time;
+        std::vector<float> intersections;
+        std::vector<float> shadowRays;
+        std::vector<float> recursion;
+    };
+
+    bool parseChannel(const std::string &name, Channel &channel);
+    std::string channelName(Channel channel);
+}
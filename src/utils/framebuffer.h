@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+
+// A floating-point image that the ray tracer renders into. Pixels hold linear radiance, which is allowed to
+// exceed 1; conversion to 8-bit color only happens when the frame is written out.
+struct FrameBuffer {
+    FrameBuffer(int width, int height) :
+        width(width),
+        height(height),
+        pixels(width * height, glm::vec4(0.f, 0.f, 0.f, 1.f))
+    {}
+
+    int width;
+    int height;
+    std::vector<glm::vec4> pixels;
+
+    glm::vec4 *data() { return pixels.data(); }
+    const glm::vec4 *data() const { return pixels.data(); }
+    int size() const { return width * height; }
+};
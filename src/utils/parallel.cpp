@@ -0,0 +1,33 @@
+#include "parallel.h"
+
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace Parallel {
+    /**
+     * @brief forEachBand - splits the rows of an image into bands and calls the given function on each band,
+     * spreading the bands across the global thread pool if parallel is set
+     * @param height - The height of the image
+     * @param parallel - Whether to process bands concurrently
+     * @param function - Called with the first row and one past the last row of each band
+     * @param bandHeight - The number of rows in each band
+     */
+    void forEachBand(int height, bool parallel, const std::function<void(int, int)> &function, int bandHeight) {
+        QVector<int> bandStarts;
+        for (int row = 0; row < height; row += bandHeight) {
+            bandStarts.append(row);
+        }
+
+        auto runBand = [&](int bandStart) {
+            function(bandStart, std::min(bandStart + bandHeight, height));
+        };
+
+        if (parallel) {
+            QtConcurrent::blockingMap(bandStarts, runBand);
+        } else {
+            for (int bandStart : bandStarts) {
+                runBand(bandStart);
+            }
+        }
+    }
+}
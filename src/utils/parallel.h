@@ -0,0 +1,10 @@
+#pragma once
+
+#include <functional>
+
+namespace Parallel {
+    // The number of rows handed to a worker at a time, unless the caller asks for something else
+    const int DEFAULT_BAND_HEIGHT = 32;
+
+    void forEachBand(int height, bool parallel, const std::function<void(int, int)> &function, int bandHeight = DEFAULT_BAND_HEIGHT);
+}
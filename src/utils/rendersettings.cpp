@@ -0,0 +1,72 @@
+#include "rendersettings.h"
+
+#include <algorithm>
+
+namespace RenderSettings {
+    /**
+     * @brief from - looks settings up in a config file, after first checking a set of overrides
+     * @param settings - the config file, which must outlive the lookup
+     * @param overrides - values by "Section/key" name that replace the file's
+     * @return the lookup
+     */
+    Lookup from(const QSettings &settings, const QVariantMap &overrides) {
+        return [&settings, overrides](const QString &key, const QVariant &defaultValue) {
+            auto overridden = overrides.find(key);
+            if (overridden != overrides.end()) {
+                return overridden.value();
+            }
+            return settings.value(key, defaultValue);
+        };
+    }
+
+    /**
+     * @brief rayTracerConfig - reads the [Feature] and [Denoise] sections
+     * @param value - the settings to read
+     * @return the tracer's config
+     */
+    RayTracer::Config rayTracerConfig(const Lookup &value) {
+        RayTracer::Config config{};
+        config.enableShadow          = value("Feature/shadows", false).toBool();
+        config.enableReflection      = value("Feature/reflect", false).toBool();
+        config.enableRefraction      = value("Feature/refract", false).toBool();
+        config.enableTextureMap      = value("Feature/texture", false).toBool();
+        config.enableTextureFilter   = value("Feature/texture-filter", false).toBool();
+        config.enableParallelism     = value("Feature/parallel", false).toBool();
+        config.enableSuperSample     = value("Feature/super-sample", false).toBool();
+        config.numSamples            = value("Feature/num-samples", 0).toInt();
+        config.enablePostProcess     = value("Feature/post-process", false).toBool();
+        config.enableAcceleration    = value("Feature/acceleration", false).toBool();
+        config.enableDepthOfField    = value("Feature/depthoffield", false).toBool();
+        config.enableDenoise         = value("Feature/denoise", false).toBool();
+        config.deterministicSampling = value("Feature/deterministic-sampling", false).toBool();
+
+        config.denoiser.iterations  = value("Denoise/iterations", config.denoiser.iterations).toInt();
+        config.denoiser.sigmaColor  = value("Denoise/sigma-color", config.denoiser.sigmaColor).toFloat();
+        config.denoiser.sigmaNormal = value("Denoise/sigma-normal", config.denoiser.sigmaNormal).toFloat();
+        config.denoiser.sigmaAlbedo = value("Denoise/sigma-albedo", config.denoiser.sigmaAlbedo).toFloat();
+        config.denoiser.sigmaDepth  = value("Denoise/sigma-depth", config.denoiser.sigmaDepth).toFloat();
+        return config;
+    }
+
+    /**
+     * @brief toneMapConfig - reads the tone mapping settings of the [Output] section
+     * @param value - the settings to read
+     * @param config - filled in with the settings
+     * @return false if the operator is unknown
+     */
+    bool toneMapConfig(const Lookup &value, ToneMap::Config &config) {
+        config = ToneMap::Config{};
+        if (!ToneMap::parseOperator(value("Output/tonemap", "clamp").toString().toStdString(), config.op)) {
+            return false;
+        }
+        config.exposure = value("Output/exposure", 1.f).toFloat();
+        config.srgb     = value("Output/srgb", false).toBool();
+        return true;
+    }
+
+    int pngQuality(const Lookup &value) {
+        // QImage takes a PNG "quality" from 0 to 100 instead of a zlib level, so convert the level into one
+        int pngCompression = value("Output/png-compression", -1).toInt();
+        return pngCompression < 0 ? -1 : 100 - (std::min(pngCompression, 9) * 91 + 8) / 9;
+    }
+}
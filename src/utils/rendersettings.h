@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QSettings>
+#include <QVariantMap>
+#include <functional>
+#include "raytracer/raytracer.h"
+#include "filter/tonemap.h"
+
+// Reads the renderer's settings out of a config file, so every way of starting a render agrees on what they mean
+namespace RenderSettings {
+    // Looks up a setting by its "Section/key" name, or returns the default if it isn't set
+    using Lookup = std::function<QVariant(const QString &key, const QVariant &defaultValue)>;
+
+    // The settings of a config file, with any overrides taking precedence over the file
+    Lookup from(const QSettings &settings, const QVariantMap &overrides = {});
+
+    RayTracer::Config rayTracerConfig(const Lookup &value);
+
+    // @return false if the tone mapping operator is unknown
+    bool toneMapConfig(const Lookup &value, ToneMap::Config &config);
+
+    // QImage's PNG "quality" from 0 to 100 for the configured zlib level, or -1 for Qt's default
+    int pngQuality(const Lookup &value);
+}
@@ -1,5 +1,6 @@
 #include "sceneparser.h"
 #include "scenefilereader.h"
+#include "trace.h"
 #include "glm/gtx/transform.hpp"
 
 #include <chrono>
@@ -129,7 +130,11 @@ void SceneParser::buildRenderObjects(SceneNode *node, RenderData *rd, glm::mat4
  */
 bool SceneParser::parse(std::string filepath, std::vector<RenderData*> &renderData) {
     ScenefileReader fileReader = ScenefileReader(filepath);
-    bool success = fileReader.readXML();
+    bool success;
+    {
+        Trace::Span span("read scene file", -1);
+        success = fileReader.readXML();
+    }
     std::cout << "Parsed file" << std::endl;
 
     if (!success) {
@@ -147,6 +152,7 @@ bool SceneParser::parse(std::string filepath, std::vector<RenderData*> &renderDa
         rd->lights.clear();
 
         // start at the root with an identity matrix
+        Trace::Span span("build render objects", i);
         buildRenderObjects(fileReader.getRootNode(), rd, glm::mat4(1.0f), i);
 
         renderData.push_back(rd);
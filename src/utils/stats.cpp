@@ -0,0 +1,140 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace Stats {
+    namespace {
+        const char *COUNTER_NAMES[COUNTER_COUNT] = {
+            "primary_rays", "reflection_rays", "shadow_rays", "intersection_tests", "hits", "texture_samples",
+            "lights_evaluated"
+        };
+
+        const char *PHASE_NAMES[PHASE_COUNT] = { "build", "trace", "filter", "encode" };
+
+        struct Registration;
+
+        // Every live thread's slots, plus whatever threads that have since exited counted before they did
+        std::mutex registryMutex;
+        std::vector<Registration *> registry;
+        std::array<std::uint64_t, Detail::SLOT_COUNT> retired{};
+
+        // Registers a thread's slots for as long as the thread lives. collect() never writes the slots, since the
+        // thread may be adding to them at the same time; it remembers what it last read from them instead.
+        struct Registration {
+            Detail::Slots slots;
+            std::array<std::uint64_t, Detail::SLOT_COUNT> collected{};
+
+            Registration() {
+                std::lock_guard<std::mutex> lock(registryMutex);
+                registry.push_back(this);
+            }
+
+            ~Registration() {
+                std::lock_guard<std::mutex> lock(registryMutex);
+                for (std::size_t i = 0; i < retired.size(); i++) {
+                    retired[i] += slots.values[i].load(std::memory_order_relaxed) - collected[i];
+                }
+                registry.erase(std::find(registry.begin(), registry.end(), this));
+            }
+        };
+    }
+
+    Detail::Slots &Detail::local() {
+        thread_local Registration registration;
+        return registration.slots;
+    }
+
+    Frame &Frame::operator+=(const Frame &other) {
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            counters[i] += other.counters[i];
+        }
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            seconds[i] += other.seconds[i];
+        }
+        return *this;
+    }
+
+    const char *counterName(Counter counter) {
+        return COUNTER_NAMES[counter];
+    }
+
+    const char *phaseName(Phase phase) {
+        return PHASE_NAMES[phase];
+    }
+
+    /**
+     * @brief collect - adds up what every thread has counted since the last call, including threads that have exited
+     * since
+     * @return the counts since the last call
+     */
+    Frame collect() {
+        std::array<std::uint64_t, Detail::SLOT_COUNT> totals{};
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            totals = retired;
+            retired.fill(0);
+            for (Registration *registration : registry) {
+                for (std::size_t i = 0; i < totals.size(); i++) {
+                    const std::uint64_t value = registration->slots.values[i].load(std::memory_order_relaxed);
+                    totals[i] += value - registration->collected[i];
+                    registration->collected[i] = value;
+                }
+            }
+        }
+
+        Frame frame;
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            frame.counters[i] = totals[i];
+        }
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            frame.seconds[i] = totals[int(COUNTER_COUNT) + i] * 1e-9;
+        }
+        return frame;
+    }
+
+    /**
+     * @brief toJsonLine - formats a frame's counts as a JSON object on one line
+     * @param frame - the frame's number
+     * @param stats - its counts
+     */
+    std::string toJsonLine(int frame, const Frame &stats) {
+        std::ostringstream line;
+        line << "{\"frame\":" << frame;
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            line << ",\"" << COUNTER_NAMES[i] << "\":" << stats.counters[i];
+        }
+        line << ",\"seconds\":{";
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            line << (i > 0 ? "," : "") << "\"" << PHASE_NAMES[i] << "\":" << stats.seconds[i];
+        }
+        line << "}}";
+        return line.str();
+    }
+
+    /**
+     * @brief toPrometheus - formats run totals for Prometheus, e.g. for node_exporter's textfile collector
+     * @param totals - the counts of every frame so far
+     * @param frames - how many frames they cover
+     */
+    std::string toPrometheus(const Frame &totals, int frames) {
+        std::ostringstream text;
+        text << "# HELP skippy_frames_total Frames rendered.\n"
+             << "# TYPE skippy_frames_total counter\n"
+             << "skippy_frames_total " << frames << "\n";
+
+        for (int i = 0; i < COUNTER_COUNT; i++) {
+            text << "# TYPE skippy_" << COUNTER_NAMES[i] << "_total counter\n"
+                 << "skippy_" << COUNTER_NAMES[i] << "_total " << totals.counters[i] << "\n";
+        }
+
+        text << "# HELP skippy_phase_seconds_total Time spent in each phase of rendering a frame.\n"
+             << "# TYPE skippy_phase_seconds_total counter\n";
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            text << "skippy_phase_seconds_total{phase=\"" << PHASE_NAMES[i] << "\"} " << totals.seconds[i] << "\n";
+        }
+        return text.str();
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Set by CMake from the SKIPPY_ENABLE_STATS option. When it's 0, every SKIPPY_STAT and Stats::PhaseTimer compiles to
+// nothing, and Stats::collect always comes back empty.
+#ifndef SKIPPY_ENABLE_STATS
+#define SKIPPY_ENABLE_STATS 1
+#endif
+
+// Counts what the tracer does and how long each phase of a frame takes. Each thread counts into its own slots, so
+// counting never contends between threads; collect() adds the slots up once the frame is done.
+namespace Stats {
+    constexpr bool ENABLED = SKIPPY_ENABLE_STATS;
+
+    enum Counter {
+        PRIMARY_RAYS,       // Camera rays, one per sample
+        REFLECTION_RAYS,
+        SHADOW_RAYS,
+        INTERSECTION_TESTS, // Rays tested against a single primitive
+        HITS,               // Camera and reflection rays that hit something
+        TEXTURE_SAMPLES,
+        LIGHTS_EVALUATED,   // Lights whose contribution was worked out at a surface point
+        COUNTER_COUNT
+    };
+
+    enum Phase {
+        BUILD,  // Constructing the RayTraceScene
+        TRACE,
+        FILTER, // Denoising and blurring
+        ENCODE, // Tone mapping and writing the frame, which is timed by whoever does it rather than collected
+        PHASE_COUNT
+    };
+
+    // Everything counted over some stretch of rendering, usually a frame
+    struct Frame {
+        std::array<std::uint64_t, COUNTER_COUNT> counters{};
+        std::array<double, PHASE_COUNT> seconds{};
+
+        Frame &operator+=(const Frame &other);
+    };
+
+    // snake_case names, as they appear in reports
+    const char *counterName(Counter counter);
+    const char *phaseName(Phase phase);
+
+    // Adds up what every thread has counted since the last call. A thread that is still counting while this runs has
+    // whatever it counted after its slots were read included in the next call, so no count is lost or counted twice.
+    Frame collect();
+
+    // A frame's counts as a single line of JSON, with no trailing newline
+    std::string toJsonLine(int frame, const Frame &stats);
+
+    // Running totals in Prometheus' text exposition format
+    std::string toPrometheus(const Frame &totals, int frames);
+
+    namespace Detail {
+        // A slot per counter, followed by one per phase holding nanoseconds
+        constexpr int SLOT_COUNT = int(COUNTER_COUNT) + int(PHASE_COUNT);
+
+        // The slots of one thread. They only ever grow, and only that thread writes them, so the atomics are only
+        // there so collect() can read them safely, and compile to plain loads and stores.
+        struct Slots {
+            std::array<std::atomic<std::uint64_t>, SLOT_COUNT> values{};
+        };
+
+        Slots &local();
+
+        inline void add(int slot, std::uint64_t amount) {
+            thread_local Slots &slots = local();
+            std::atomic<std::uint64_t> &value = slots.values[slot];
+            value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+
+        inline std::uint64_t get(int slot) {
+            thread_local Slots &slots = local();
+            return slots.values[slot].load(std::memory_order_relaxed);
+        }
+    }
+
+    inline void add(Counter counter, std::uint64_t amount = 1) {
+        Detail::add(counter, amount);
+    }
+
+    // What the calling thread has counted since it started. The difference between two calls is what the thread
+    // counted in between, which lets a single pixel's work be picked out of the totals.
+    inline std::uint64_t threadCount(Counter counter) {
+        return Detail::get(counter);
+    }
+
+    // Adds the time until it goes out of scope to a phase of the current thread
+    class PhaseTimer {
+    public:
+#if SKIPPY_ENABLE_STATS
+        explicit PhaseTimer(Phase phase) : m_phase(phase), m_start(std::chrono::steady_clock::now()) {}
+        ~PhaseTimer() {
+            const auto elapsed = std::chrono::steady_clock::now() - m_start;
+            Detail::add(int(COUNTER_COUNT) + m_phase, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+    private:
+        const Phase m_phase;
+        const std::chrono::steady_clock::time_point m_start;
+#else
+        explicit PhaseTimer(Phase) {}
+#endif
+    };
+}
+
+#if SKIPPY_ENABLE_STATS
+#define SKIPPY_STAT(counter, amount) Stats::add(Stats::counter, (amount))
+#else
+#define SKIPPY_STAT(counter, amount) ((void) 0)
+#endif
@@ -0,0 +1,220 @@
+#include "trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+namespace Trace {
+    std::atomic<bool> Detail::recording{ false };
+
+    namespace {
+        struct Event {
+            const char *name;
+            double start;    // Microseconds since recording started
+            double duration; // Microseconds
+            int thread;
+            int frame;
+            std::string args;
+        };
+
+        std::mutex mutex;
+        std::string outputPath;
+        Clock::time_point origin;
+        std::vector<Event> events;
+        std::map<int, std::string> threadNames;
+
+        std::atomic<int> currentFrame{ -1 };
+        std::atomic<int> nextThread{ 0 };
+        std::atomic<std::uint64_t> nextSerial{ 1 };
+
+        // A small number for the calling thread, which is easier to read in the timeline than a native thread id
+        int currentThread() {
+            thread_local int thread = nextThread++;
+            return thread;
+        }
+
+        // Adds an event to the timeline, giving its thread a default name if it doesn't have one yet
+        void add(Event &&event) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (threadNames.find(event.thread) == threadNames.end()) {
+                threadNames[event.thread] = "thread " + std::to_string(event.thread);
+            }
+            events.push_back(std::move(event));
+        }
+
+        // Quotes a string for JSON; names and args here never need more than quotes and backslashes escaped
+        std::string quoted(const std::string &text) {
+            std::string result = "\"";
+            for (char c : text) {
+                if (c == '"' || c == '\\') {
+                    result += '\\';
+                }
+                result += c;
+            }
+            return result + "\"";
+        }
+    }
+
+    /**
+     * @brief start - clears anything recorded before and starts recording
+     * @param path - where finish() writes the timeline
+     */
+    void start(const std::string &path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        outputPath = path;
+        origin = Clock::now();
+        events.clear();
+        Detail::recording = true;
+    }
+
+    /**
+     * @brief finish - stops recording and writes the timeline as a Chrome trace-event JSON file
+     * @return whether the file was written
+     */
+    bool finish() {
+        if (!Detail::recording.exchange(false)) {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ofstream out(outputPath);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        bool first = true;
+        auto separator = [&first]() {
+            const char *result = first ? "" : ",\n";
+            first = false;
+            return result;
+        };
+
+        for (const auto &[thread, name] : threadNames) {
+            out << separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+                << ",\"args\":{\"name\":" << quoted(name) << "}}";
+        }
+
+        char times[64];
+        for (const Event &event : events) {
+            std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", event.start, event.duration);
+            out << separator() << "{\"name\":" << quoted(event.name) << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                << "," << times << ",\"args\":{";
+            if (event.frame >= 0) {
+                out << "\"frame\":" << event.frame << (event.args.empty() ? "" : ",");
+            }
+            out << event.args << "}}";
+        }
+
+        out << "\n]}\n";
+        events.clear();
+        return out.good();
+    }
+
+    void setFrame(int frame) {
+        currentFrame = frame;
+    }
+
+    void nameThread(const std::string &name) {
+        const int thread = currentThread();
+        std::lock_guard<std::mutex> lock(mutex);
+        threadNames[thread] = name;
+    }
+
+    /**
+     * @brief record - adds a finished span to the timeline, if recording
+     * @param name - what the span was; it has to stay valid until finish(), which a string literal always does
+     * @param start - when it started
+     * @param finish - when it finished
+     * @param frame - the frame it belonged to, CURRENT_FRAME for the one set by setFrame, or -1 for none
+     * @param args - extra JSON members for its args
+     */
+    void record(const char *name, Clock::time_point start, Clock::time_point finish, int frame, const std::string &args) {
+        if (!enabled()) {
+            return;
+        }
+        if (frame == CURRENT_FRAME) {
+            frame = currentFrame;
+        }
+        add(Event{
+            name,
+            std::chrono::duration<double, std::micro>(start - origin).count(),
+            std::chrono::duration<double, std::micro>(finish - start).count(),
+            currentThread(),
+            frame,
+            args
+        });
+    }
+
+    TileSpans::TileSpans(const char *name) :
+        m_name(name),
+        m_enabled(Trace::enabled()),
+        m_frame(currentFrame),
+        m_serial(nextSerial++)
+    {}
+
+    TileSpans::~TileSpans() {
+        for (const std::unique_ptr<Run> &run : m_runs) {
+            if (run->first >= 0) {
+                recordRun(*run);
+            }
+        }
+    }
+
+    /**
+     * @brief TileSpans::local - the calling thread's run in this loop, which it starts the first time it's asked for
+     */
+    TileSpans::Run &TileSpans::local() {
+        struct Cached {
+            std::uint64_t serial = 0;
+            Run *run = nullptr;
+        };
+        thread_local Cached cached;
+
+        if (cached.serial != m_serial) {
+            auto run = std::make_unique<Run>();
+            run->thread = currentThread();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            cached = Cached{ m_serial, run.get() };
+            m_runs.push_back(std::move(run));
+        }
+        return *cached.run;
+    }
+
+    /**
+     * @brief TileSpans::begin - notes that the calling thread is starting on a pixel, closing its current run first
+     * if the pixel doesn't carry on from it
+     */
+    void TileSpans::begin(int index) {
+        Run &run = local();
+        if (run.first >= 0 && index == run.last + 1) {
+            run.last = index;
+            return;
+        }
+
+        if (run.first >= 0) {
+            recordRun(run);
+        }
+        run.first = index;
+        run.last = index;
+        run.start = Clock::now();
+    }
+
+    void TileSpans::end() {
+        local().finish = Clock::now();
+    }
+
+    void TileSpans::recordRun(const Run &run) const {
+        if (!Trace::enabled()) {
+            return;
+        }
+
+        // recorded under the thread that did the work, whichever thread closes the run
+        add(Event{
+            m_name,
+            std::chrono::duration<double, std::micro>(run.start - origin).count(),
+            std::chrono::duration<double, std::micro>(run.finish - run.start).count(),
+            run.thread,
+            m_frame,
+            "\"first pixel\":" + std::to_string(run.first) + ",\"pixels\":" + std::to_string(run.last - run.first + 1)
+        });
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records a timeline of a render as Chrome trace events, which chrome://tracing and Perfetto (ui.perfetto.dev) can
+// open. Each span shows which thread it ran on and which frame it belonged to, so idle workers and serial stretches of
+// the pipeline can be seen directly. Nothing is recorded unless start() has been called, and a span that isn't
+// recorded costs a single check.
+namespace Trace {
+    using Clock = std::chrono::steady_clock;
+
+    // Tags a span with the frame set by setFrame
+    const int CURRENT_FRAME = INT_MIN;
+
+    // Starts recording; the timeline is written to path by finish()
+    void start(const std::string &path);
+
+    // Stops recording and writes everything recorded to the file given to start()
+    // @return Whether the file was written, which is also true if nothing was being recorded.
+    bool finish();
+
+    namespace Detail {
+        extern std::atomic<bool> recording;
+    }
+
+    inline bool enabled() {
+        return Detail::recording.load(std::memory_order_relaxed);
+    }
+
+    // Sets the frame that spans on any thread are tagged with unless they say otherwise, or -1 for none
+    void setFrame(int frame);
+
+    // Names the calling thread in the timeline; unnamed threads are numbered in the order they first record a span
+    void nameThread(const std::string &name);
+
+    // Records a finished span on the calling thread
+    // @param args Extra JSON members for the span's args, e.g. "\"pixels\":64", or empty.
+    void record(const char *name, Clock::time_point start, Clock::time_point finish, int frame = CURRENT_FRAME,
+                const std::string &args = {});
+
+    // A span lasting as long as this is in scope
+    class Span {
+    public:
+        explicit Span(const char *name, int frame = CURRENT_FRAME) :
+            m_name(enabled() ? name : nullptr),
+            m_frame(frame),
+            m_start(m_name != nullptr ? Clock::now() : Clock::time_point{})
+        {}
+
+        ~Span() {
+            if (m_name != nullptr) {
+                record(m_name, m_start, Clock::now(), m_frame);
+            }
+        }
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *m_name;
+        const int m_frame;
+        const Clock::time_point m_start;
+    };
+
+    // Turns the pixels each thread handles during a parallel loop into spans, one per unbroken run of consecutive
+    // pixels. QtConcurrent hands each thread a block of consecutive items at a time, so the spans show the blocks
+    // each worker was actually given, and the gaps between them show the workers waiting.
+    class TileSpans {
+    public:
+        explicit TileSpans(const char *name);
+
+        // Records the runs still open on every thread; only valid once the loop is done
+        ~TileSpans();
+
+        bool enabled() const { return m_enabled; }
+
+        // Called by a worker before and after each pixel
+        void begin(int index);
+        void end();
+
+        TileSpans(const TileSpans &) = delete;
+        TileSpans &operator=(const TileSpans &) = delete;
+
+    private:
+        // The run of pixels a thread is in the middle of
+        struct Run {
+            int thread = -1;
+            int first = -1;
+            int last = -1;
+            Clock::time_point start;
+            Clock::time_point finish;
+        };
+
+        Run &local();
+        void recordRun(const Run &run) const;
+
+        const char *m_name;
+        const bool m_enabled;
+        const int m_frame;
+        const std::uint64_t m_serial; // Tells this loop's runs apart from those of earlier loops on the same threads
+        std::mutex m_mutex;
+        std::vector<std::unique_ptr<Run>> m_runs;
+    };
+}
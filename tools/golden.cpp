@@ -0,0 +1,271 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "core/skippy.h"
+#include "farm/frameselection.h"
+#include "filter/tonemap.h"
+#include "output/framewriter.h"
+
+// Golden-image regression check: renders a set of reference scenes small, with every feature on and super-samples
+// placed deterministically, and compares each frame against a stored golden image. A frame fails if too many pixels
+// are off by more than a small tolerance, or if it looks structurally different (mean SSIM below a threshold). Each
+// failure leaves the new render and a heatmap of where it differs in the output directory.
+
+namespace {
+    struct ReferenceScene {
+        const char *path;
+        std::vector<int> frames;
+    };
+
+    // Scenes that between them cover every primitive, light type, texturing, shadows, reflection and refraction. The
+    // frames of each are picked to look different: rotating_cube's cube turns 2.4 degrees a frame and looks the same
+    // every 90 degrees, so its second frame is a fraction of a quarter turn on rather than halfway through.
+    const ReferenceScene DEFAULT_SCENES[] = {
+        { "scenes/shadow_test.xml", { 0, 150 } },
+        { "scenes/reflection.xml", { 0, 105 } },
+        { "scenes/mirror_refl.xml", { 0, 120 } },
+        { "scenes/texture_sphere.xml", { 0, 75 } },
+        { "scenes/spot_light_2.xml", { 0, 75 } },
+        { "scenes/recursiveSpheres3.xml", { 0, 75 } },
+        { "scenes/rotating_cube.xml", { 0, 20 } }
+    };
+
+    struct Comparison {
+        double badFraction = 0; // Fraction of pixels with a channel further off than the pixel tolerance
+        int maxDifference = 0;  // Largest difference in any channel, out of 255
+        double ssim = 1;        // Mean structural similarity of the luminance, 1 for identical images
+    };
+
+    double luminance(const RGBA &pixel) {
+        return (0.299 * pixel.r + 0.587 * pixel.g + 0.114 * pixel.b) / 255.0;
+    }
+
+    int difference(const RGBA &a, const RGBA &b) {
+        return std::max({ std::abs(a.r - b.r), std::abs(a.g - b.g), std::abs(a.b - b.b) });
+    }
+
+    /**
+     * @brief ssim - the mean structural similarity of two images' luminance, over 8x8 windows half overlapping
+     * (Wang et al. 2004, with uniform rather than Gaussian weights)
+     */
+    double ssim(const std::vector<RGBA> &a, const std::vector<RGBA> &b, int width, int height) {
+        const double C1 = 0.01 * 0.01;
+        const double C2 = 0.03 * 0.03;
+        const int window = std::min({ 8, width, height });
+        const int step = std::max(window / 2, 1);
+
+        double total = 0;
+        int windows = 0;
+        for (int top = 0; top + window <= height; top += step) {
+            for (int left = 0; left + window <= width; left += step) {
+                double sumA = 0, sumB = 0, sumAA = 0, sumBB = 0, sumAB = 0;
+                for (int row = top; row < top + window; row++) {
+                    for (int col = left; col < left + window; col++) {
+                        const double x = luminance(a[row * width + col]);
+                        const double y = luminance(b[row * width + col]);
+                        sumA += x;
+                        sumB += y;
+                        sumAA += x * x;
+                        sumBB += y * y;
+                        sumAB += x * y;
+                    }
+                }
+
+                const double n = window * window;
+                const double meanA = sumA / n, meanB = sumB / n;
+                const double varA = sumAA / n - meanA * meanA;
+                const double varB = sumBB / n - meanB * meanB;
+                const double covariance = sumAB / n - meanA * meanB;
+                total += ((2 * meanA * meanB + C1) * (2 * covariance + C2))
+                        / ((meanA * meanA + meanB * meanB + C1) * (varA + varB + C2));
+                windows++;
+            }
+        }
+
+        return windows > 0 ? total / windows : 1;
+    }
+
+    Comparison compare(const std::vector<RGBA> &actual, const std::vector<RGBA> &golden, int width, int height,
+                       int pixelTolerance) {
+        Comparison result;
+        long bad = 0;
+        for (std::size_t i = 0; i < actual.size(); i++) {
+            const int d = difference(actual[i], golden[i]);
+            result.maxDifference = std::max(result.maxDifference, d);
+            bad += d > pixelTolerance;
+        }
+        result.badFraction = double(bad) / actual.size();
+        result.ssim = ssim(actual, golden, width, height);
+        return result;
+    }
+
+    /**
+     * @brief heatmap - colors each pixel by how far apart two images are there, from black (identical) through red
+     * and yellow to white (off by four times the pixel tolerance or more)
+     */
+    std::vector<RGBA> heatmap(const std::vector<RGBA> &actual, const std::vector<RGBA> &golden, int pixelTolerance) {
+        std::vector<RGBA> heat(actual.size());
+        const float scale = 1.f / (4.f * std::max(pixelTolerance, 1));
+        for (std::size_t i = 0; i < actual.size(); i++) {
+            const float t = std::min(difference(actual[i], golden[i]) * scale, 1.f);
+            auto ramp = [t](float start) {
+                return std::uint8_t(255 * std::clamp(3 * t - start, 0.f, 1.f));
+            };
+            heat[i] = RGBA{ ramp(0), ramp(1), ramp(2) };
+        }
+        return heat;
+    }
+
+    /**
+     * @brief readGolden - loads a golden image as 8-bit RGBA
+     * @return false if it's missing or not the expected size
+     */
+    bool readGolden(const QString &path, int width, int height, std::vector<RGBA> &pixels) {
+        QImage image(path);
+        if (image.isNull() || image.width() != width || image.height() != height) {
+            return false;
+        }
+
+        image = image.convertToFormat(QImage::Format_RGBX8888);
+        pixels.resize(std::size_t(width) * height);
+        for (int row = 0; row < height; row++) {
+            std::copy_n(reinterpret_cast<const RGBA *>(image.constScanLine(row)), width, pixels.data() + std::size_t(row) * width);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("scenes", "Scene files to check (default: the reference scenes).", "[scenes...]");
+    QCommandLineOption goldenOption("golden", "Directory of golden images.", "dir", "golden");
+    QCommandLineOption outputOption("output", "Where to write the renders and heatmaps of failed frames.", "dir", "golden-failures");
+    QCommandLineOption updateOption("update", "Write the renders as the new golden images instead of checking them.");
+    QCommandLineOption widthOption("width", "Width to render at.", "pixels", "128");
+    QCommandLineOption heightOption("height", "Height to render at.", "pixels", "96");
+    QCommandLineOption samplesOption("samples", "Samples per pixel.", "n", "4");
+    QCommandLineOption framesOption("frames", "Frames to check from each scene, spread over its animation (the reference scenes have their own by default).", "n", "2");
+    QCommandLineOption pixelOption("pixel-tolerance", "How far off a channel may be (out of 255) before the pixel counts as different.", "n", "3");
+    QCommandLineOption badOption("max-bad-pixels", "Fraction of pixels allowed to be different.", "fraction", "0.002");
+    QCommandLineOption ssimOption("min-ssim", "Lowest mean SSIM that passes.", "value", "0.99");
+    parser.addOptions({ goldenOption, outputOption, updateOption, widthOption, heightOption, samplesOption, framesOption,
+                        pixelOption, badOption, ssimOption });
+    parser.process(a);
+
+    const int width = parser.value(widthOption).toInt();
+    const int height = parser.value(heightOption).toInt();
+    const int samples = std::max(parser.value(samplesOption).toInt(), 1);
+    const int framesPerScene = std::max(parser.value(framesOption).toInt(), 1);
+    const int pixelTolerance = parser.value(pixelOption).toInt();
+    const double maxBadFraction = parser.value(badOption).toDouble();
+    const double minSsim = parser.value(ssimOption).toDouble();
+    const bool update = parser.isSet(updateOption);
+
+    // the reference scenes check their own frames unless --frames asks for others
+    std::vector<std::pair<QString, std::vector<int>>> scenes;
+    for (const QString &path : parser.positionalArguments()) {
+        scenes.emplace_back(path, std::vector<int>());
+    }
+    if (scenes.empty()) {
+        for (const ReferenceScene &scene : DEFAULT_SCENES) {
+            scenes.emplace_back(scene.path, parser.isSet(framesOption) ? std::vector<int>() : scene.frames);
+        }
+    }
+
+    // every feature is on so every code path is covered, and samples land in the same place on every run and thread
+    RayTracer::Config config{};
+    config.enableShadow          = true;
+    config.enableReflection      = true;
+    config.enableRefraction      = true;
+    config.enableTextureMap      = true;
+    config.enableParallelism     = true;
+    config.enableSuperSample     = samples > 1;
+    config.numSamples            = samples;
+    config.enablePostProcess     = true;
+    config.enableAcceleration    = true;
+    config.deterministicSampling = true;
+
+    const QDir goldenDir(parser.value(goldenOption));
+    const QDir outputDir(parser.value(outputOption));
+    if (!QDir().mkpath(update ? goldenDir.path() : outputDir.path())) {
+        std::cerr << "Error: failed to create \"" << (update ? goldenDir : outputDir).path().toStdString() << "\"" << std::endl;
+        return 1;
+    }
+
+    FrameBuffer frame(width, height);
+    std::vector<RGBA> actual(frame.size());
+    std::vector<RGBA> golden;
+    int checked = 0, failed = 0, missing = 0;
+
+    for (const auto &[path, sceneFrames] : scenes) {
+        std::shared_ptr<const Skippy::Scene> scene = Skippy::Scene::load(path.toStdString());
+        if (!scene) {
+            std::cerr << "Error loading scene: \"" << path.toStdString() << "\"" << std::endl;
+            failed++;
+            continue;
+        }
+
+        const std::vector<int> frames = sceneFrames.empty() ? FrameSelection::spread(scene->frameCount(), framesPerScene) : sceneFrames;
+        for (int frameNumber : frames) {
+            if (!Skippy::render(scene->frame(frameNumber), frame, config)) {
+                std::cerr << "Error rendering frame " << frameNumber << " of \"" << path.toStdString() << "\"" << std::endl;
+                failed++;
+                continue;
+            }
+            ToneMap::apply(frame, actual.data(), ToneMap::Config{}, config.enableParallelism);
+
+            const QString name = QString("%1_%2.png").arg(QFileInfo(path).completeBaseName()).arg(frameNumber, 4, 10, QChar('0'));
+            if (update) {
+                const std::string goldenPath = goldenDir.filePath(name).toStdString();
+                if (!FrameWriter::writeBytes(goldenPath, "png", actual.data(), width, height, -1)) {
+                    std::cerr << "Error: failed to write \"" << goldenPath << "\"" << std::endl;
+                    return 1;
+                }
+                std::cout << "Updated " << goldenPath << std::endl;
+                continue;
+            }
+
+            checked++;
+            if (!readGolden(goldenDir.filePath(name), width, height, golden)) {
+                std::cout << "MISSING " << name.toStdString() << " (no " << width << "x" << height << " golden image)" << std::endl;
+                missing++;
+                continue;
+            }
+
+            const Comparison result = compare(actual, golden, width, height, pixelTolerance);
+            const bool passed = result.badFraction <= maxBadFraction && result.ssim >= minSsim;
+            std::cout << (passed ? "ok      " : "FAILED  ") << name.toStdString() << ": " << result.badFraction * 100
+                      << "% of pixels differ, max difference " << result.maxDifference << ", SSIM " << result.ssim << std::endl;
+            if (passed) {
+                continue;
+            }
+
+            failed++;
+            const QString stem = outputDir.filePath(QFileInfo(name).completeBaseName());
+            FrameWriter::writeBytes((stem + ".actual.png").toStdString(), "png", actual.data(), width, height, -1);
+            const std::vector<RGBA> heat = heatmap(actual, golden, pixelTolerance);
+            FrameWriter::writeBytes((stem + ".diff.png").toStdString(), "png", heat.data(), width, height, -1);
+        }
+    }
+
+    if (update) {
+        return 0;
+    }
+
+    std::cout << std::endl << checked << " frame(s) checked, " << failed << " failed, " << missing << " missing" << std::endl;
+    if (failed > 0) {
+        std::cout << "Renders and heatmaps of the failures are in \"" << outputDir.path().toStdString() << "\"" << std::endl;
+        return 1;
+    }
+    return missing > 0 ? 2 : 0;
+}
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Generates scene files for stress tests and scaling studies: any number of randomly placed, animated shapes and
+// lights, textured from a directory of images, optionally nested in a deep scene graph. The same options and seed
+// always give the same scene.
+//
+// Usage: skippy_scenegen [options] <output.xml>
+//   --shapes <n>      shapes to place (default 100)
+//   --lights <n>      lights, cycling through point, directional and spot (default 4)
+//   --textures <n>    distinct textures to spread over the shapes, taken from --texture-dir (default 0)
+//   --texture-dir <d> where the textures come from (default textures)
+//   --keyframes <n>   keyframes per animated transform; 1 keeps everything still (default 4)
+//   --depth <n>       levels of nested, separately animated groups above each shape (default 1)
+//   --branching <n>   child groups per group (default 4)
+//   --reflective <f>  fraction of shapes that are reflective (default 0.2)
+//   --duration <s>    length of the animation in seconds (default 2)
+//   --framerate <n>   frames per second (default 24)
+//   --seed <n>        random seed (default 1230)
+
+namespace {
+    struct Options {
+        int shapes = 100;
+        int lights = 4;
+        int textures = 0;
+        std::string textureDir = "textures";
+        int keyframes = 4;
+        int depth = 1;
+        int branching = 4;
+        float reflective = 0.2f;
+        float duration = 2.f;
+        int framerate = 24;
+        unsigned seed = 1230;
+        std::string output;
+    };
+
+    const char *PRIMITIVES[] = { "cube", "sphere", "cylinder", "cone" };
+
+    class Generator {
+    public:
+        Generator(const Options &options, const std::vector<std::string> &textures) :
+            m_options(options),
+            m_textures(textures),
+            m_random(options.seed),
+            // shapes fill a cube whose volume grows with their number, so the density stays about the same
+            m_extent(1.5f * std::cbrt(float(std::max(options.shapes, 1))))
+        {}
+
+        std::string scene() {
+            std::ostringstream xml;
+            xml << "<scenefile>\n"
+                << "\t<globaldata>\n"
+                << "\t\t<diffusecoeff v=\"0.5\" />\n"
+                << "\t\t<specularcoeff v=\"0.5\" />\n"
+                << "\t\t<ambientcoeff v=\"0.5\" />\n\n"
+                << "\t\t<framerate fps=\"" << m_options.framerate << "\" />\n"
+                << "\t\t<duration seconds=\"" << m_options.duration << "\" />\n"
+                << "\t</globaldata>\n\n"
+                << "\t<object type=\"tree\" name=\"root\">\n";
+
+            camera(xml, 2);
+            for (int i = 0; i < m_options.lights; i++) {
+                light(xml, 2, i);
+            }
+
+            // every shape sits depth groups down, and the shapes are dealt out evenly between the deepest groups
+            int leafGroups = 1;
+            for (int level = 0; level < m_options.depth; level++) {
+                leafGroups *= m_options.branching;
+            }
+            std::vector<int> shapesPerGroup(leafGroups, m_options.shapes / leafGroups);
+            for (int i = 0; i < m_options.shapes % leafGroups; i++) {
+                shapesPerGroup[i]++;
+            }
+
+            int nextGroup = 0;
+            group(xml, 2, 0, shapesPerGroup, nextGroup);
+
+            xml << "\t</object>\n"
+                << "</scenefile>\n";
+            return xml.str();
+        }
+
+    private:
+        float uniform(float low, float high) {
+            return std::uniform_real_distribution<float>(low, high)(m_random);
+        }
+
+        static std::string indent(int level) {
+            return std::string(level, '\t');
+        }
+
+        // The fractional key of each of n keyframes, spread evenly over the animation
+        static float key(int index, int count) {
+            return count > 1 ? float(index) / (count - 1) : 0.f;
+        }
+
+        void camera(std::ostringstream &xml, int level) {
+            const float distance = 2.5f * m_extent + 3.f;
+            xml << indent(level) << "<transblock>\n"
+                << indent(level + 1) << "<keyframe type=\"fractional\" key=\"0\">\n"
+                << indent(level + 2) << "<translate id=\"0\" x=\"0\" y=\"0\" z=\"" << distance << "\" />\n"
+                << indent(level + 1) << "</keyframe>\n\n"
+                << indent(level + 1) << "<cameradata>\n"
+                << indent(level + 2) << "<keyframe type=\"fractional\" key=\"0\">\n"
+                << indent(level + 3) << "<look x=\"0\" y=\"0\" z=\"-1\" />\n"
+                << indent(level + 3) << "<up x=\"0\" y=\"1\" z=\"0\" />\n"
+                << indent(level + 3) << "<heightangle v=\"45\" />\n"
+                << indent(level + 2) << "</keyframe>\n"
+                << indent(level + 1) << "</cameradata>\n"
+                << indent(level) << "</transblock>\n\n";
+        }
+
+        // Lights drift around the shapes, and share out roughly the same total brightness however many there are
+        void light(std::ostringstream &xml, int level, int id) {
+            static const char *TYPES[] = { "point", "directional", "spot" };
+            const char *type = TYPES[id % 3];
+            const float brightness = 1.5f / std::sqrt(float(std::max(m_options.lights, 1)));
+
+            xml << indent(level) << "<transblock>\n";
+            for (int k = 0; k < m_options.keyframes; k++) {
+                xml << indent(level + 1) << "<keyframe type=\"fractional\" key=\"" << key(k, m_options.keyframes) << "\">\n"
+                    << indent(level + 2) << "<translate id=\"0\" x=\"" << uniform(-m_extent, m_extent) << "\" y=\""
+                    << uniform(m_extent, 2 * m_extent) << "\" z=\"" << uniform(-m_extent, 2 * m_extent) << "\" />\n"
+                    << indent(level + 1) << "</keyframe>\n";
+            }
+
+            xml << "\n" << indent(level + 1) << "<lightdata id=\"" << id << "\" type=\"" << type << "\">\n"
+                << indent(level + 2) << "<keyframe type=\"fractional\" key=\"0\">\n"
+                << indent(level + 3) << "<color r=\"" << brightness * uniform(0.6f, 1.f) << "\" g=\""
+                << brightness * uniform(0.6f, 1.f) << "\" b=\"" << brightness * uniform(0.6f, 1.f) << "\" />\n";
+            if (std::string(type) != "point") {
+                xml << indent(level + 3) << "<direction x=\"" << uniform(-0.5f, 0.5f) << "\" y=\"-1\" z=\""
+                    << uniform(-0.5f, 0.5f) << "\" />\n";
+            }
+            if (std::string(type) == "spot") {
+                xml << indent(level + 3) << "<penumbra v=\"10\" />\n"
+                    << indent(level + 3) << "<angle v=\"40\" />\n";
+            }
+            if (std::string(type) != "directional") {
+                xml << indent(level + 3) << "<function x=\"1\" y=\"0\" z=\"0\" />\n";
+            }
+            xml << indent(level + 2) << "</keyframe>\n"
+                << indent(level + 1) << "</lightdata>\n"
+                << indent(level) << "</transblock>\n\n";
+        }
+
+        // A transform that turns about a random axis over the animation, along with an optional fixed translation
+        void animation(std::ostringstream &xml, int level, float turns, float offset) {
+            const float ax = uniform(-1.f, 1.f), ay = uniform(0.2f, 1.f), az = uniform(-1.f, 1.f);
+            const float tx = uniform(-offset, offset), ty = uniform(-offset, offset), tz = uniform(-offset, offset);
+
+            for (int k = 0; k < m_options.keyframes; k++) {
+                xml << indent(level) << "<keyframe type=\"fractional\" key=\"" << key(k, m_options.keyframes) << "\">\n"
+                    << indent(level + 1) << "<translate id=\"0\" x=\"" << tx << "\" y=\"" << ty << "\" z=\"" << tz << "\" />\n"
+                    << indent(level + 1) << "<rotate id=\"1\" x=\"" << ax << "\" y=\"" << ay << "\" z=\"" << az
+                    << "\" angle=\"" << 360.f * turns * key(k, m_options.keyframes) << "\" />\n"
+                    << indent(level) << "</keyframe>\n";
+            }
+        }
+
+        // A group of groups, or of shapes once it's deep enough, turning slowly as a whole
+        void group(std::ostringstream &xml, int level, int depth, const std::vector<int> &shapesPerGroup, int &nextGroup) {
+            if (depth == m_options.depth) {
+                for (int i = 0; i < shapesPerGroup[nextGroup]; i++) {
+                    shape(xml, level);
+                }
+                nextGroup++;
+                return;
+            }
+
+            for (int child = 0; child < m_options.branching; child++) {
+                xml << indent(level) << "<transblock>\n";
+                animation(xml, level + 1, uniform(-0.25f, 0.25f), 0.1f * m_extent);
+                xml << "\n" << indent(level + 1) << "<object type=\"tree\">\n";
+                group(xml, level + 2, depth + 1, shapesPerGroup, nextGroup);
+                xml << indent(level + 1) << "</object>\n"
+                    << indent(level) << "</transblock>\n\n";
+            }
+        }
+
+        void shape(std::ostringstream &xml, int level) {
+            const char *primitive = PRIMITIVES[std::uniform_int_distribution<int>(0, 3)(m_random)];
+            const float size = uniform(0.3f, 1.f);
+
+            xml << indent(level) << "<transblock>\n";
+            for (int k = 0; k < m_options.keyframes; k++) {
+                // each shape wanders a little from where it started, and turns as it goes
+                xml << indent(level + 1) << "<keyframe type=\"fractional\" key=\"" << key(k, m_options.keyframes) << "\">\n";
+                if (k == 0) {
+                    m_position[0] = uniform(-m_extent, m_extent);
+                    m_position[1] = uniform(-m_extent, m_extent);
+                    m_position[2] = uniform(-m_extent, m_extent);
+                } else {
+                    for (float &coordinate : m_position) {
+                        coordinate += uniform(-0.5f, 0.5f);
+                    }
+                }
+                xml << indent(level + 2) << "<translate id=\"0\" x=\"" << m_position[0] << "\" y=\"" << m_position[1]
+                    << "\" z=\"" << m_position[2] << "\" />\n"
+                    << indent(level + 2) << "<rotate id=\"1\" x=\"0\" y=\"1\" z=\"0\" angle=\""
+                    << 180.f * key(k, m_options.keyframes) << "\" />\n"
+                    << indent(level + 2) << "<scale id=\"2\" x=\"" << size << "\" y=\"" << size << "\" z=\"" << size << "\" />\n"
+                    << indent(level + 1) << "</keyframe>\n";
+            }
+
+            xml << "\n" << indent(level + 1) << "<object type=\"primitive\" name=\"" << primitive << "\">\n"
+                << indent(level + 2) << "<diffuse r=\"" << uniform(0.1f, 1.f) << "\" g=\"" << uniform(0.1f, 1.f)
+                << "\" b=\"" << uniform(0.1f, 1.f) << "\" />\n"
+                << indent(level + 2) << "<specular r=\"0.8\" g=\"0.8\" b=\"0.8\" />\n"
+                << indent(level + 2) << "<shininess v=\"" << uniform(5.f, 50.f) << "\" />\n";
+            if (uniform(0.f, 1.f) < m_options.reflective) {
+                xml << indent(level + 2) << "<reflective r=\"0.5\" g=\"0.5\" b=\"0.5\" />\n";
+            }
+            if (!m_textures.empty()) {
+                xml << indent(level + 2) << "<texture file=\"" << m_textures[m_nextTexture++ % m_textures.size()]
+                    << "\" u=\"1\" v=\"1\" />\n"
+                    << indent(level + 2) << "<blend v=\"0.7\" />\n";
+            }
+            xml << indent(level + 1) << "</object>\n"
+                << indent(level) << "</transblock>\n";
+        }
+
+        const Options &m_options;
+        const std::vector<std::string> &m_textures;
+        std::mt19937 m_random;
+        const float m_extent;
+        float m_position[3] = { 0.f, 0.f, 0.f };
+        std::size_t m_nextTexture = 0;
+    };
+
+    /**
+     * @brief pickTextures - chooses the textures to use, as paths the scene parser resolves from the scene file.
+     * The parser resolves textures from the directory above the scene's, where scenes/ and textures/ both live.
+     * @return the paths, or nothing if there aren't enough images in the directory
+     */
+    std::vector<std::string> pickTextures(const Options &options) {
+        std::vector<std::string> textures;
+        if (options.textures <= 0) {
+            return textures;
+        }
+
+        std::error_code error;
+        std::vector<std::filesystem::path> images;
+        for (const auto &entry : std::filesystem::directory_iterator(options.textureDir, error)) {
+            const std::string extension = entry.path().extension().string();
+            if (extension == ".png" || extension == ".jpg" || extension == ".jpeg") {
+                images.push_back(entry.path());
+            }
+        }
+        std::sort(images.begin(), images.end());
+
+        const std::filesystem::path base = std::filesystem::absolute(options.output).parent_path().parent_path();
+        for (int i = 0; i < options.textures && i < int(images.size()); i++) {
+            textures.push_back(std::filesystem::relative(std::filesystem::absolute(images[i]), base).generic_string());
+        }
+        return textures;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (hasValue && arg == "--shapes") {
+            options.shapes = std::max(std::atoi(argv[++i]), 0);
+        } else if (hasValue && arg == "--lights") {
+            options.lights = std::max(std::atoi(argv[++i]), 0);
+        } else if (hasValue && arg == "--textures") {
+            options.textures = std::max(std::atoi(argv[++i]), 0);
+        } else if (hasValue && arg == "--texture-dir") {
+            options.textureDir = argv[++i];
+        } else if (hasValue && arg == "--keyframes") {
+            options.keyframes = std::max(std::atoi(argv[++i]), 1);
+        } else if (hasValue && arg == "--depth") {
+            options.depth = std::max(std::atoi(argv[++i]), 0);
+        } else if (hasValue && arg == "--branching") {
+            options.branching = std::max(std::atoi(argv[++i]), 1);
+        } else if (hasValue && arg == "--reflective") {
+            options.reflective = float(std::atof(argv[++i]));
+        } else if (hasValue && arg == "--duration") {
+            options.duration = float(std::atof(argv[++i]));
+        } else if (hasValue && arg == "--framerate") {
+            options.framerate = std::max(std::atoi(argv[++i]), 1);
+        } else if (hasValue && arg == "--seed") {
+            options.seed = unsigned(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg.rfind("--", 0) != 0 && options.output.empty()) {
+            options.output = arg;
+        } else {
+            std::cerr << "Unknown or incomplete option \"" << arg << "\"; see the top of tools/scenegen.cpp for usage" << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.output.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [options] <output.xml>" << std::endl;
+        return 1;
+    }
+
+    // a huge branching factor to the power of the depth would leave most groups empty
+    long leafGroups = 1;
+    for (int level = 0; level < options.depth; level++) {
+        leafGroups *= options.branching;
+        if (leafGroups > 1000000) {
+            std::cerr << "--depth " << options.depth << " with --branching " << options.branching << " makes too many groups" << std::endl;
+            return 1;
+        }
+    }
+
+    const std::vector<std::string> textures = pickTextures(options);
+    if (int(textures.size()) < options.textures) {
+        std::cerr << "Only found " << textures.size() << " texture(s) in \"" << options.textureDir << "\"" << std::endl;
+        return 1;
+    }
+
+    Generator generator(options, textures);
+    std::ofstream file(options.output);
+    file << generator.scene();
+    if (!file.good()) {
+        std::cerr << "Error: failed to write \"" << options.output << "\"" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << options.shapes << " shape(s), " << options.lights << " light(s) and " << textures.size()
+              << " texture(s) to \"" << options.output << "\"" << std::endl;
+    return 0;
+}